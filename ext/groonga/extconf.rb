@@ -148,6 +148,12 @@ $defs << "-DGRN_MICRO_VERSION=#{real_micro}"
 have_header("ruby/st.h") unless have_macro("HAVE_RUBY_ST_H", "ruby.h")
 have_func("rb_errinfo", "ruby.h")
 have_type("enum ruby_value_type", "ruby.h")
+if have_header("pthread.h") and have_library("pthread", "pthread_create")
+  $defs << "-DRB_GRN_HAVE_PTHREAD"
+end
+have_header("ruby/thread.h")
+have_func("rb_thread_call_without_gvl", "ruby/thread.h")
+have_func("rb_thread_blocking_region", "ruby.h")
 
 checking_for(checking_message("debug flag")) do
   debug = with_config("debug")
@@ -175,11 +175,13 @@ rb_grn_array_add (int argc, VALUE *argv, VALUE self)
     grn_id id;
     VALUE values;
 
+    rb_check_frozen(self);
     rb_scan_args(argc, argv, "01", &values);
 
     table = SELF(self, &context);
 
     id = grn_table_add(context, table, NULL, 0, NULL);
+    rb_grn_database_object_modified(table);
     rb_grn_context_check(context, self);
 
     if (GRN_ID_NIL == id) {
@@ -75,6 +75,7 @@ rb_grn_column_bind (RbGrnColumn *rb_column,
     rb_grn_named_object_bind(RB_GRN_NAMED_OBJECT(rb_column), context, column);
     rb_column->value = grn_obj_open(context, GRN_BULK, 0,
                                     rb_grn_object->range_id);
+    rb_column->time_format = RB_GRN_TIME_FORMAT_TIME;
 }
 
 void
@@ -109,6 +110,150 @@ rb_grn_column_deconstruct (RbGrnColumn *rb_column,
 	*value = rb_column->value;
 }
 
+/*
+ * Reads the value of _id_ record into _value_ that isn't
+ * initialized yet. Vector values are read as GRN_UVECTOR for
+ * fixed size elements and GRN_VECTOR for variable size elements.
+ */
+static void
+rb_grn_column_get_raw (VALUE self, grn_id id, grn_obj *value,
+		       grn_ctx **context, grn_obj **range)
+{
+    grn_obj *column;
+    grn_id range_id;
+    VALUE exception;
+
+    rb_grn_column_deconstruct(SELF(self), &column, context,
+			      NULL, NULL,
+			      NULL, &range_id, range);
+    if ((column->header.flags & GRN_OBJ_COLUMN_TYPE_MASK) ==
+	GRN_OBJ_COLUMN_VECTOR) {
+	if (*range &&
+	    (*range)->header.type == GRN_TYPE &&
+	    ((*range)->header.flags & GRN_OBJ_KEY_VAR_SIZE)) {
+	    GRN_OBJ_INIT(value, GRN_VECTOR, 0, range_id);
+	} else {
+	    GRN_OBJ_INIT(value, GRN_UVECTOR, 0, range_id);
+	}
+    } else {
+	GRN_OBJ_INIT(value, GRN_BULK, 0, range_id);
+    }
+    grn_obj_get_value(*context, column, id, value);
+    exception = rb_grn_context_to_exception(*context, self);
+    if (!NIL_P(exception)) {
+	GRN_OBJ_FIN(*context, value);
+	rb_exc_raise(exception);
+    }
+}
+
+/*
+ * Returns the referenced record ID of _id_ record as Integer for
+ * a scalar reference column and Array of Integer for a vector
+ * reference column. It doesn't create Groonga::Record.
+ */
+VALUE
+rb_grn_column_get_ids (VALUE self, grn_id id)
+{
+    grn_ctx *context = NULL;
+    grn_obj *range = NULL;
+    grn_obj value;
+    VALUE rb_ids;
+
+    rb_grn_column_deconstruct(SELF(self), NULL, NULL,
+			      NULL, NULL,
+			      NULL, NULL, &range);
+    if (!range || range->header.type == GRN_TYPE)
+	rb_raise(rb_eArgError, "not a reference column: <%s>",
+		 rb_grn_inspect(self));
+
+    rb_grn_column_get_raw(self, id, &value, &context, &range);
+    if (value.header.type == GRN_UVECTOR) {
+	rb_ids = rb_grn_uvector_to_ruby_object(context, &value);
+    } else if (GRN_BULK_VSIZE(&value) < sizeof(grn_id) ||
+	       *((grn_id *)GRN_BULK_HEAD(&value)) == GRN_ID_NIL) {
+	rb_ids = Qnil;
+    } else {
+	rb_ids = UINT2NUM(*((grn_id *)GRN_BULK_HEAD(&value)));
+    }
+    GRN_OBJ_FIN(context, &value);
+
+    return rb_ids;
+}
+
+/*
+ * Returns the value of _id_ record in a vector column of fixed
+ * size elements such as Int32 and references as a binary String
+ * that has the elements in native byte order.
+ */
+VALUE
+rb_grn_column_get_packed (VALUE self, grn_id id)
+{
+    grn_ctx *context = NULL;
+    grn_obj *range = NULL;
+    grn_obj value;
+    VALUE rb_packed;
+
+    rb_grn_column_get_raw(self, id, &value, &context, &range);
+    if (value.header.type != GRN_UVECTOR) {
+	GRN_OBJ_FIN(context, &value);
+	rb_raise(rb_eArgError,
+		 "packed value is available only for "
+		 "vector column of fixed size values: <%s>",
+		 rb_grn_inspect(self));
+    }
+    rb_packed = rb_str_new(GRN_BULK_HEAD(&value), GRN_BULK_VSIZE(&value));
+    GRN_OBJ_FIN(context, &value);
+
+    return rb_packed;
+}
+
+/*
+ * Returns the value of _id_ record in a vector column as an
+ * Array of [value, weight]. rroonga stores vector elements with
+ * weight 0. So the weight isn't 0 only for a value stored by
+ * other interface such as groonga's C API.
+ */
+VALUE
+rb_grn_column_get_with_weight (VALUE self, grn_id id)
+{
+    grn_ctx *context = NULL;
+    grn_obj *range = NULL;
+    grn_obj value;
+    VALUE rb_value;
+
+    rb_grn_column_get_raw(self, id, &value, &context, &range);
+    switch (value.header.type) {
+      case GRN_VECTOR:
+	rb_value = rb_grn_vector_to_ruby_object_with_weight(context, &value,
+							    self);
+	break;
+      case GRN_UVECTOR:
+	{
+	    VALUE rb_elements;
+	    long i;
+
+	    /* elements of fixed size don't have weight. */
+	    rb_elements = GRNVALUE2RVAL(context, &value, range, self);
+	    rb_value = rb_ary_new2(RARRAY_LEN(rb_elements));
+	    for (i = 0; i < RARRAY_LEN(rb_elements); i++) {
+		rb_ary_push(rb_value,
+			    rb_assoc_new(RARRAY_PTR(rb_elements)[i],
+					 INT2NUM(0)));
+	    }
+	}
+	break;
+      default:
+	GRN_OBJ_FIN(context, &value);
+	rb_raise(rb_eArgError,
+		 "weight is available only for vector column: <%s>",
+		 rb_grn_inspect(self));
+	break;
+    }
+    GRN_OBJ_FIN(context, &value);
+
+    return rb_value;
+}
+
 /*
  * call-seq:
  *   column.table -> Groonga::Table
@@ -277,6 +422,11 @@ rb_grn_column_get_local_name (VALUE self)
  *   は利用する。
  *
  *   参考: Groonga::Expression#parse.
+ *
+ * @option options :id_bitmap
+ *   +true+ を指定すると結果のテーブルではなく、マッチしたレ
+ *   コードのIDを持つGroonga::IdBitmapを返す。 +:result+ と
+ *   は一緒に使えない。
  */
 static VALUE
 rb_grn_column_select (int argc, VALUE *argv, VALUE self)
@@ -288,6 +438,7 @@ rb_grn_column_select (int argc, VALUE *argv, VALUE self)
     VALUE rb_query, condition_or_options;
     VALUE rb_name, rb_operator, rb_result, rb_syntax;
     VALUE rb_allow_pragma, rb_allow_column, rb_allow_update;
+    VALUE rb_id_bitmap;
     VALUE builder;
     VALUE rb_expression = Qnil;
 
@@ -323,8 +474,14 @@ rb_grn_column_select (int argc, VALUE *argv, VALUE self)
 			"allow_pragma", &rb_allow_pragma,
 			"allow_column", &rb_allow_column,
 			"allow_update", &rb_allow_update,
+			"id_bitmap", &rb_id_bitmap,
 			NULL);
 
+    if (RVAL2CBOOL(rb_id_bitmap) && !NIL_P(rb_result))
+	rb_raise(rb_eArgError,
+		 "should not pass both of :id_bitmap and :result: %s",
+		 rb_grn_inspect(rb_ary_new4(argc, argv)));
+
     if (!NIL_P(rb_operator))
 	operator = NUM2INT(rb_operator);
 
@@ -335,6 +492,7 @@ rb_grn_column_select (int argc, VALUE *argv, VALUE self)
 				  0);
 	rb_result = GRNTABLE2RVAL(context, result, GRN_TRUE);
     } else {
+	rb_check_frozen(rb_result);
 	result = RVAL2GRNTABLE(rb_result, &context);
     }
 
@@ -351,8 +509,19 @@ rb_grn_column_select (int argc, VALUE *argv, VALUE self)
                               NULL, NULL, NULL, NULL);
 
     grn_table_select(context, table, expression, result, operator);
+    if (rb_grn_table_select_may_update_p(condition_or_options, rb_syntax,
+					 rb_allow_update))
+	rb_grn_database_object_modified(table);
     rb_grn_context_check(context, self);
 
+    if (RVAL2CBOOL(rb_id_bitmap)) {
+	VALUE rb_bitmap;
+
+	rb_bitmap = rb_grn_id_bitmap_new_from_table(context, result);
+	rb_grn_object_close(rb_result);
+	return rb_bitmap;
+    }
+
     rb_attr(rb_singleton_class(rb_result),
 	    rb_intern("expression"),
 	    GRN_TRUE, GRN_FALSE, GRN_FALSE);
@@ -552,6 +721,63 @@ rb_grn_column_is_locked (int argc, VALUE *argv, VALUE self)
     return CBOOL2RVAL(grn_obj_is_locked(context, column));
 }
 
+/*
+ * call-seq:
+ *   column.time_format -> :time, :usec or :float
+ *
+ * Time型の値を読み込むときの形式を返す。
+ */
+static VALUE
+rb_grn_column_get_time_format (VALUE self)
+{
+    switch (SELF(self)->time_format) {
+      case RB_GRN_TIME_FORMAT_USEC:
+	return ID2SYM(rb_intern("usec"));
+      case RB_GRN_TIME_FORMAT_FLOAT:
+	return ID2SYM(rb_intern("float"));
+      default:
+	return ID2SYM(rb_intern("time"));
+    }
+}
+
+/*
+ * call-seq:
+ *   column.time_format = format
+ *
+ * Time型の値を読み込むときの形式を設定する。 _format_ に指定
+ * 可能な値は以下の通り。
+ *
+ * [+:time+]
+ *   Timeを返す。デフォルト。
+ * [+:usec+]
+ *   UNIX時刻をマイクロ秒単位で表したIntegerを返す。Timeを
+ *   作らないので大量の値を読み込む場合に速い。
+ * [+:float+]
+ *   UNIX時刻を秒単位で表したFloatを返す。 <tt>Time#to_f</tt>
+ *   と同じ値になる。
+ */
+static VALUE
+rb_grn_column_set_time_format (VALUE self, VALUE rb_format)
+{
+    RbGrnColumn *rb_grn_column;
+
+    rb_grn_column = SELF(self);
+    if (NIL_P(rb_format) || rb_grn_equal_option(rb_format, "time")) {
+	rb_grn_column->time_format = RB_GRN_TIME_FORMAT_TIME;
+    } else if (rb_grn_equal_option(rb_format, "usec")) {
+	rb_grn_column->time_format = RB_GRN_TIME_FORMAT_USEC;
+    } else if (rb_grn_equal_option(rb_format, "float")) {
+	rb_grn_column->time_format = RB_GRN_TIME_FORMAT_FLOAT;
+    } else {
+	rb_raise(rb_eArgError,
+		 "time format should be one of "
+		 "[nil, :time, :usec, :float]: %s",
+		 rb_grn_inspect(rb_format));
+    }
+
+    return Qnil;
+}
+
 /*
  * Document-method: reference?
  *
@@ -747,6 +973,10 @@ rb_grn_init_column (VALUE mGrn)
     rb_define_method(rb_cGrnColumn, "unlock", rb_grn_column_unlock, -1);
     rb_define_method(rb_cGrnColumn, "clear_lock", rb_grn_column_clear_lock, -1);
     rb_define_method(rb_cGrnColumn, "locked?", rb_grn_column_is_locked, -1);
+    rb_define_method(rb_cGrnColumn, "time_format",
+		     rb_grn_column_get_time_format, 0);
+    rb_define_method(rb_cGrnColumn, "time_format=",
+		     rb_grn_column_set_time_format, 1);
     rb_define_method(rb_cGrnColumn, "reference?", rb_grn_column_reference_p, 0);
     /* deprecated: backward compatibility */
     rb_define_alias(rb_cGrnColumn, "reference_column?", "reference?");
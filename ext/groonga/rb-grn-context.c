@@ -18,6 +18,10 @@
 
 #include "rb-grn.h"
 
+#ifdef HAVE_RUBY_THREAD_H
+#  include <ruby/thread.h>
+#endif
+
 #define SELF(object) (RVAL2GRNCONTEXT(object))
 
 static VALUE cGrnContext;
@@ -569,6 +573,34 @@ rb_grn_context_get_database (VALUE self)
     return GRNDB2RVAL(context, grn_ctx_db(context), GRN_FALSE);
 }
 
+/*
+ * call-seq:
+ *   context.use_database(database) -> Groonga::Database
+ *
+ * 他のコンテキストで開いたデータベース _database_ をこのコン
+ * テキストでも使う。同じデータベースを複数のスレッドで使う
+ * 場合にスレッドごとにデータベースを開かなくてよい。
+ * _database_ はこのコンテキストを閉じるまで閉じないこと。
+ */
+static VALUE
+rb_grn_context_use_database (VALUE self, VALUE rb_database)
+{
+    grn_ctx *context, *database_context = NULL;
+    grn_obj *database;
+
+    context = SELF(self);
+    database = RVAL2GRNOBJECT(rb_database, &database_context);
+    if (!database || database->header.type != GRN_DB)
+	rb_raise(rb_eArgError, "should be a database: <%s>",
+		 rb_grn_inspect(rb_database));
+    grn_ctx_use(context, database);
+    rb_grn_context_check(context, self);
+    /* keep the database alive while the context uses it. */
+    rb_iv_set(self, "database", rb_database);
+
+    return rb_database;
+}
+
 /*
  * call-seq:
  *   context.connect(options=nil)
@@ -623,56 +655,245 @@ rb_grn_context_connect (int argc, VALUE *argv, VALUE self)
     return Qnil;
 }
 
-/*
- * call-seq:
- *   context.send(string) -> ID
- *
- * groongaサーバにクエリ文字列を送信する。
- */
-static VALUE
-rb_grn_context_send (VALUE self, VALUE rb_string)
+typedef struct _RbGrnContextIOData RbGrnContextIOData;
+struct _RbGrnContextIOData
 {
     grn_ctx *context;
     char *string;
     unsigned int string_size;
-    int flags = 0;
+    int flags;
     unsigned int query_id;
+};
 
-    context = SELF(self);
-    string = StringValuePtr(rb_string);
-    string_size = RSTRING_LEN(rb_string);
-    query_id = grn_ctx_send(context, string, string_size, flags);
-    rb_grn_context_check(context, self);
+static void *
+rb_grn_context_send_without_gvl (void *user_data)
+{
+    RbGrnContextIOData *data = user_data;
+
+    data->query_id = grn_ctx_send(data->context,
+				  data->string, data->string_size,
+				  data->flags);
+    return NULL;
+}
+
+static void *
+rb_grn_context_receive_without_gvl (void *user_data)
+{
+    RbGrnContextIOData *data = user_data;
 
-    return UINT2NUM(query_id);
+    data->query_id = grn_ctx_recv(data->context,
+				  &(data->string), &(data->string_size),
+				  &(data->flags));
+    return NULL;
+}
+
+#if !defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL) && \
+    defined(HAVE_RB_THREAD_BLOCKING_REGION)
+static VALUE
+rb_grn_context_send_blocking_region (void *user_data)
+{
+    rb_grn_context_send_without_gvl(user_data);
+    return Qnil;
+}
+
+static VALUE
+rb_grn_context_receive_blocking_region (void *user_data)
+{
+    rb_grn_context_receive_without_gvl(user_data);
+    return Qnil;
+}
+#endif
+
+static grn_bool
+rb_grn_context_command_name_p (const char *name, size_t name_size,
+			       const char **names)
+{
+    for (; *names; names++) {
+	if (strlen(*names) == name_size &&
+	    memcmp(*names, name, name_size) == 0)
+	    return GRN_TRUE;
+    }
+    return GRN_FALSE;
+}
+
+/*
+ * Updates modification counts for the command in _string_.
+ * Commands that only read don't update them. Data sent after
+ * "load" has no command name so it is treated as data change.
+ */
+static void
+rb_grn_context_send_notify_modification (const char *string,
+					 unsigned int string_size)
+{
+    static const char *read_only_commands[] = {
+	"select", "status", "table_list", "column_list", "dump",
+	"check", "normalize", "tokenize", "cache_limit", "log_put",
+	"quit", NULL
+    };
+    static const char *schema_commands[] = {
+	"table_create", "table_remove", "table_rename",
+	"column_create", "column_remove", "column_rename",
+	"register", "plugin_register", "plugin_unregister", NULL
+    };
+    const char *current = string, *end = string + string_size;
+    const char *name;
+
+    while (current < end && (*current == ' ' || *current == '\t' ||
+			     *current == '\n' || *current == '\r'))
+	current++;
+    if (end - current >= 3 && memcmp(current, "/d/", 3) == 0)
+	current += 3;
+    name = current;
+    while (current < end && *current != ' ' && *current != '\t' &&
+	   *current != '\n' && *current != '\r' &&
+	   *current != '?' && *current != '.')
+	current++;
+
+    if (rb_grn_context_command_name_p(name, current - name,
+				      read_only_commands))
+	return;
+    rb_grn_database_modified();
+    if (rb_grn_context_command_name_p(name, current - name,
+				      schema_commands))
+	rb_grn_database_schema_modified();
+}
+
+static grn_bool
+rb_grn_context_io_without_gvl_p (VALUE options)
+{
+    VALUE rb_without_gvl;
+
+    rb_grn_scan_options(options,
+			"without_gvl", &rb_without_gvl,
+			NULL);
+    if (!RVAL2CBOOL(rb_without_gvl))
+	return GRN_FALSE;
+
+    rb_grn_logger_check_without_gvl();
+    return GRN_TRUE;
 }
 
 /*
  * call-seq:
- *   context.receive -> [ID, String]
+ *   context.send(string, options={}) -> ID
+ *
+ * groongaサーバにクエリ文字列を送信する。ローカルのデータベー
+ * スを使っている場合はここでコマンドを実行する。
+ *
+ * selectなどの参照だけするコマンド以外のときは
+ * Groonga::Database#modification_countを更新し、
+ * Groonga::Table#selectの +:cache+ で保持している結果を無効
+ * にする。table_createやcolumn_removeなどスキーマを変更する
+ * コマンドのときは +:reuse_expression+ で保持している式も無
+ * 効にする。
+ *
+ * @option options [Boolean] :without_gvl (false) releases GVL
+ *   while sending (and executing with a local database) so
+ *   that other Ruby threads can run. The context must not be
+ *   used by other threads until it returns. It raises
+ *   ArgumentError while Groonga::Logger that isn't buffered is
+ *   registered because the logger calls Ruby from groonga. It
+ *   is ignored on Ruby 1.8.
+ */
+static VALUE
+rb_grn_context_send (int argc, VALUE *argv, VALUE self)
+{
+    RbGrnContextIOData data;
+    VALUE rb_string, options;
+
+    rb_scan_args(argc, argv, "11", &rb_string, &options);
+    data.context = SELF(self);
+    data.flags = 0;
+    data.query_id = 0;
+    if (rb_grn_context_io_without_gvl_p(options)) {
+	rb_string = rb_str_new_frozen(StringValue(rb_string));
+	data.string = RSTRING_PTR(rb_string);
+	data.string_size = RSTRING_LEN(rb_string);
+#if defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL)
+	rb_thread_call_without_gvl(rb_grn_context_send_without_gvl, &data,
+				   NULL, NULL);
+#elif defined(HAVE_RB_THREAD_BLOCKING_REGION)
+	rb_thread_blocking_region(rb_grn_context_send_blocking_region, &data,
+				  NULL, NULL);
+#else
+	rb_grn_context_send_without_gvl(&data);
+#endif
+    } else {
+	data.string = StringValuePtr(rb_string);
+	data.string_size = RSTRING_LEN(rb_string);
+	rb_grn_context_send_without_gvl(&data);
+    }
+    rb_grn_context_send_notify_modification(data.string, data.string_size);
+    rb_grn_context_check(data.context, self);
+
+    return UINT2NUM(data.query_id);
+}
+
+/*
+ * call-seq:
+ *   context.receive(options={}) -> [ID, String]
  *
  * groongaサーバからクエリ実行結果文字列を受信する。
+ *
+ * @option options [Boolean] :without_gvl (false) releases GVL
+ *   while waiting for the result. See Groonga::Context#send.
  */
 static VALUE
-rb_grn_context_receive (VALUE self)
+rb_grn_context_receive (int argc, VALUE *argv, VALUE self)
 {
-    grn_ctx *context;
-    char *result = NULL;
-    unsigned result_size;
-    VALUE rb_result;
-    int flags = 0;
-    unsigned int query_id;
+    RbGrnContextIOData data;
+    VALUE options, rb_result;
 
-    context = SELF(self);
-    query_id = grn_ctx_recv(context, &result, &result_size, &flags);
-    if (result) {
-	rb_result = rb_str_new(result, result_size);
+    rb_scan_args(argc, argv, "01", &options);
+    data.context = SELF(self);
+    data.string = NULL;
+    data.string_size = 0;
+    data.flags = 0;
+    data.query_id = 0;
+    if (rb_grn_context_io_without_gvl_p(options)) {
+#if defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL)
+	rb_thread_call_without_gvl(rb_grn_context_receive_without_gvl, &data,
+				   NULL, NULL);
+#elif defined(HAVE_RB_THREAD_BLOCKING_REGION)
+	rb_thread_blocking_region(rb_grn_context_receive_blocking_region,
+				  &data, NULL, NULL);
+#else
+	rb_grn_context_receive_without_gvl(&data);
+#endif
+    } else {
+	rb_grn_context_receive_without_gvl(&data);
+    }
+    if (data.string) {
+	rb_result = rb_str_new(data.string, data.string_size);
     } else {
 	rb_result = Qnil;
     }
-    rb_grn_context_check(context, self);
+    rb_grn_context_check(data.context, self);
+
+    return rb_ary_new3(2, UINT2NUM(data.query_id), rb_result);
+}
+
+/*
+ * call-seq:
+ *   context.connected? -> true/false
+ *
+ * groongaサーバに接続していれば +true+ 、ローカルのデータベー
+ * スを使っていれば +false+ を返す。
+ */
+static VALUE
+rb_grn_context_connected_p (VALUE self)
+{
+    grn_ctx *context;
+    grn_ctx_info info;
+
+    context = SELF(self);
+    if (!context)
+	return Qfalse;
 
-    return rb_ary_new3(2, UINT2NUM(query_id), rb_result);
+    memset(&info, 0, sizeof(info));
+    if (grn_ctx_info_get(context, &info) != GRN_SUCCESS)
+	return Qfalse;
+    return CBOOL2RVAL(info.fd != -1);
 }
 
 static const char *
@@ -834,10 +1055,14 @@ rb_grn_init_context (VALUE mGrn)
 		     rb_grn_context_support_lzo_p, 0);
 
     rb_define_method(cGrnContext, "database", rb_grn_context_get_database, 0);
+    rb_define_method(cGrnContext, "use_database",
+		     rb_grn_context_use_database, 1);
 
     rb_define_method(cGrnContext, "[]", rb_grn_context_array_reference, 1);
 
     rb_define_method(cGrnContext, "connect", rb_grn_context_connect, -1);
-    rb_define_method(cGrnContext, "send", rb_grn_context_send, 1);
-    rb_define_method(cGrnContext, "receive", rb_grn_context_receive, 0);
+    rb_define_method(cGrnContext, "send", rb_grn_context_send, -1);
+    rb_define_method(cGrnContext, "receive", rb_grn_context_receive, -1);
+    rb_define_method(cGrnContext, "connected?",
+		     rb_grn_context_connected_p, 0);
 }
@@ -22,6 +22,9 @@
 
 VALUE rb_cGrnDatabase;
 
+static unsigned long modification_count = 0;
+static unsigned long schema_modification_count = 0;
+
 /*
  * Document-class: Groonga::Database
  *
@@ -490,6 +493,43 @@ rb_grn_database_is_locked (VALUE self)
     return CBOOL2RVAL(grn_obj_is_locked(context, database));
 }
 
+void
+rb_grn_database_modified (void)
+{
+    modification_count++;
+}
+
+/*
+ * Same as rb_grn_database_modified() but ignores changes of
+ * temporary objects such as search results because no cache
+ * depends on them.
+ */
+void
+rb_grn_database_object_modified (grn_obj *object)
+{
+    if (object && !(object->header.flags & GRN_OBJ_PERSISTENT))
+	return;
+    modification_count++;
+}
+
+unsigned long
+rb_grn_database_modification_count (void)
+{
+    return modification_count;
+}
+
+void
+rb_grn_database_schema_modified (void)
+{
+    schema_modification_count++;
+}
+
+unsigned long
+rb_grn_database_schema_modification_count (void)
+{
+    return schema_modification_count;
+}
+
 /*
  * Document-method: touch
  *
@@ -497,6 +537,11 @@ rb_grn_database_is_locked (VALUE self)
  *   database.touch
  *
  * _database_ の最終更新時刻を現在時刻にする。
+ *
+ * rroongaを経由しない方法（他のプロセスなど）でデータを変
+ * 更した場合もこのメソッドを呼ぶこと。Groonga::Database#modification_countが増えるの
+ * で、 +:cache+ 付きのGroonga::Table#selectのキャッシュが
+ * 無効になる。
  */
 static VALUE
 rb_grn_database_touch (VALUE self)
@@ -508,6 +553,117 @@ rb_grn_database_touch (VALUE self)
 				NULL, NULL, NULL, NULL);
 
     grn_db_touch(context, database);
+    rb_grn_database_modified();
+    return Qnil;
+}
+
+/*
+ * Document-method: modification_count
+ *
+ * call-seq:
+ *   database.modification_count -> Integer
+ *
+ * このプロセス内でrroongaを経由して永続テーブルのレコード
+ * やカラムの値が変更された回数を返す。検索結果などの一時テー
+ * ブルを変更しても増えない。Groonga::Database#touchを呼んだ
+ * ときも増える。
+ *
+ * 値が変わっていなければデータは変更されていない。
+ * Groonga::Table#selectの +:cache+ はこの値を使って古くなっ
+ * た結果を捨てる。
+ */
+static VALUE
+rb_grn_database_get_modification_count (VALUE self)
+{
+    return ULONG2NUM(rb_grn_database_modification_count());
+}
+
+static double
+rb_grn_database_defrag_now (void)
+{
+    struct timeval time_value;
+
+    gettimeofday(&time_value, NULL);
+    return time_value.tv_sec + time_value.tv_usec / 1000000.0;
+}
+
+typedef struct _RbGrnDatabaseDefragData RbGrnDatabaseDefragData;
+struct _RbGrnDatabaseDefragData
+{
+    grn_ctx *context;
+    grn_table_cursor *cursor;
+    grn_id start_id;
+    int threshold;
+    grn_bool without_gvl;
+    grn_bool use_timeout;
+    double timeout;
+    double start_time;
+    grn_bool use_max_segments;
+    int max_segments;
+    int n_segments;
+    VALUE self;
+    VALUE rb_cursor;
+};
+
+static VALUE
+rb_grn_database_defrag_body (VALUE user_data)
+{
+    RbGrnDatabaseDefragData *data = (RbGrnDatabaseDefragData *)user_data;
+    grn_ctx *context = data->context;
+    VALUE self = data->self;
+    grn_id id;
+    int n_columns = 0;
+
+    while ((id = grn_table_cursor_next(context, data->cursor)) !=
+	   GRN_ID_NIL) {
+	grn_obj *object;
+	int n_column_segments;
+
+	if (id < data->start_id)
+	    continue;
+
+	object = grn_ctx_at(context, id);
+	if (!object || object->header.type != GRN_COLUMN_VAR_SIZE)
+	    continue;
+
+	if (n_columns > 0 &&
+	    ((data->use_timeout &&
+	      rb_grn_database_defrag_now() - data->start_time >=
+	      data->timeout) ||
+	     (data->use_max_segments &&
+	      data->n_segments >= data->max_segments))) {
+	    rb_iv_set(self, "@defrag_next_id", UINT2NUM(id));
+	    return Qnil;
+	}
+
+	n_column_segments =
+	    rb_grn_variable_size_column_defrag_raw(context, object,
+						   data->threshold,
+						   data->without_gvl);
+	rb_grn_context_check(context, self);
+	data->n_segments += n_column_segments;
+	n_columns++;
+	if (rb_block_given_p()) {
+	    /* The block may break or raise. */
+	    rb_iv_set(self, "@defrag_next_id", UINT2NUM(id + 1));
+	    rb_yield_values(2,
+			    GRNOBJECT2RVAL(Qnil, context, object, GRN_FALSE),
+			    INT2NUM(n_column_segments));
+	}
+    }
+    rb_iv_set(self, "@defrag_next_id", Qnil);
+
+    return Qnil;
+}
+
+static VALUE
+rb_grn_database_defrag_ensure (VALUE user_data)
+{
+    RbGrnDatabaseDefragData *data = (RbGrnDatabaseDefragData *)user_data;
+
+    rb_grn_object_close(data->rb_cursor);
+    rb_iv_set(data->self, "cursor", Qnil);
+
     return Qnil;
 }
 
@@ -516,14 +672,48 @@ rb_grn_database_touch (VALUE self)
  *
  * call-seq:
  *   database.defrag(options={}) -> n_segments
+ *   database.defrag(options={}) {|column, n_segments| ...} -> n_segments
  *
  * Defrags all variable size columns in the database.
  *
+ * If any of _:soft_timeout_ , _:soft_max_segments_ or a block
+ * is given, columns are defraged one by one in ID order. The
+ * budget is per column: it is checked only before starting
+ * each column and at least one column is defraged per call.
+ * groonga defrags a column in one call like
+ * Groonga::VariableSizeColumn#defrag, so a call may exceed the
+ * budget by the cost of the last column. When the budget is
+ * used up, the rest is left for the next call, which resumes
+ * from the column. The next call also resumes after the last
+ * column passed to the block when the block breaks or raises an
+ * exception. Use #defrag_in_progress? to know whether the
+ * database has columns to be defraged by the next call.
+ *
+ * @example Defrag about 100ms per call
+ *   loop do
+ *     database.defrag(:soft_timeout => 0.1) do |column, n_segments|
+ *       puts("#{column.name}: #{n_segments}")
+ *     end
+ *     break unless database.defrag_in_progress?
+ *     sleep(1)
+ *   end
+ *
  * @return [Integer] the number of defraged segments
  * @option options [Integer] :threshold (0) the threshold to
  *   determine whether a segment is defraged. Available
  *   values are -4..22. -4 means all segments are defraged.
  *   22 means no segment is defraged.
+ * @option options [Numeric] :soft_timeout (nil) doesn't start
+ *   the next column after _:soft_timeout_ seconds are elapsed.
+ * @option options [Integer] :soft_max_segments (nil) doesn't
+ *   start the next column after _:soft_max_segments_ segments
+ *   are defraged.
+ * @option options [Boolean] :without_gvl (false) releases GVL
+ *   while defragging each column. It raises ArgumentError while
+ *   Groonga::Logger that isn't buffered is registered. See
+ *   Groonga::VariableSizeColumn#defrag.
+ * @yield [column, n_segments] the defraged column and the
+ *   number of defraged segments in it, for progress reporting.
  * @since 1.2.6
  */
 static VALUE
@@ -531,24 +721,90 @@ rb_grn_database_defrag (int argc, VALUE *argv, VALUE self)
 {
     grn_ctx *context;
     grn_obj *database;
-    int n_segments;
-    VALUE options, rb_threshold;
-    int threshold = 0;
+    grn_bool incremental;
+    VALUE options, rb_threshold, rb_timeout, rb_max_segments, rb_without_gvl;
+    VALUE rb_next_id;
+    RbGrnDatabaseDefragData data;
 
     rb_scan_args(argc, argv, "01", &options);
     rb_grn_scan_options(options,
 			"threshold", &rb_threshold,
+			"soft_timeout", &rb_timeout,
+			"soft_max_segments", &rb_max_segments,
+			"without_gvl", &rb_without_gvl,
 			NULL);
+    data.threshold = 0;
     if (!NIL_P(rb_threshold)) {
-	threshold = NUM2INT(rb_threshold);
+	data.threshold = NUM2INT(rb_threshold);
+    }
+    data.use_timeout = !NIL_P(rb_timeout);
+    data.timeout = 0.0;
+    if (data.use_timeout) {
+	data.timeout = NUM2DBL(rb_timeout);
     }
+    data.use_max_segments = !NIL_P(rb_max_segments);
+    data.max_segments = 0;
+    if (data.use_max_segments) {
+	data.max_segments = NUM2INT(rb_max_segments);
+    }
+    data.without_gvl = RVAL2CBOOL(rb_without_gvl);
+    if (data.without_gvl)
+	rb_grn_logger_check_without_gvl();
+    incremental = (data.use_timeout ||
+		   data.use_max_segments ||
+		   rb_block_given_p());
 
     rb_grn_database_deconstruct(SELF(self), &database, &context,
 				NULL, NULL, NULL, NULL);
-    n_segments = grn_obj_defrag(context, database, threshold);
+
+    if (!incremental) {
+	int n_segments;
+
+	n_segments = rb_grn_variable_size_column_defrag_raw(context, database,
+							    data.threshold,
+							    data.without_gvl);
+	rb_grn_context_check(context, self);
+	rb_iv_set(self, "@defrag_next_id", Qnil);
+	return INT2NUM(n_segments);
+    }
+
+    data.start_id = GRN_ID_NIL;
+    rb_next_id = rb_iv_get(self, "@defrag_next_id");
+    if (!NIL_P(rb_next_id))
+	data.start_id = NUM2UINT(rb_next_id);
+
+    data.context = context;
+    data.self = self;
+    data.n_segments = 0;
+    data.start_time = rb_grn_database_defrag_now();
+    data.cursor = grn_table_cursor_open(context, database, NULL, 0, NULL, 0,
+					0, -1,
+					GRN_CURSOR_BY_ID | GRN_CURSOR_ASCENDING);
     rb_grn_context_check(context, self);
+    data.rb_cursor = GRNTABLECURSOR2RVAL(Qnil, context, data.cursor);
+    rb_iv_set(self, "cursor", data.rb_cursor);
+    rb_ensure(rb_grn_database_defrag_body, (VALUE)&data,
+	      rb_grn_database_defrag_ensure, (VALUE)&data);
 
-    return INT2NUM(n_segments);
+    return INT2NUM(data.n_segments);
+}
+
+/*
+ * Document-method: defrag_in_progress?
+ *
+ * call-seq:
+ *   database.defrag_in_progress? -> true/false
+ *
+ * Returns +true+ if the last #defrag stopped by _:soft_timeout_,
+ * _:soft_max_segments_ or the block before defragging all
+ * columns.
+ *
+ * @since 1.2.9
+ */
+static VALUE
+rb_grn_database_defrag_in_progress_p (VALUE self)
+{
+    return CBOOL2RVAL(!NIL_P(rb_iv_get(self, "@defrag_next_id")));
 }
 
 void
@@ -581,5 +837,9 @@ rb_grn_init_database (VALUE mGrn)
     rb_define_method(rb_cGrnDatabase, "locked?", rb_grn_database_is_locked, 0);
 
     rb_define_method(rb_cGrnDatabase, "touch", rb_grn_database_touch, 0);
+    rb_define_method(rb_cGrnDatabase, "modification_count",
+		     rb_grn_database_get_modification_count, 0);
     rb_define_method(rb_cGrnDatabase, "defrag", rb_grn_database_defrag, -1);
+    rb_define_method(rb_cGrnDatabase, "defrag_in_progress?",
+		     rb_grn_database_defrag_in_progress_p, 0);
 }
@@ -99,6 +99,7 @@ rb_grn_expression_initialize (int argc, VALUE *argv, VALUE self)
     rb_grn_context_check(context, self);
 
     rb_iv_set(self, "@objects", rb_ary_new());
+    rb_iv_set(self, "may_update", Qfalse);
 
     return Qnil;
 }
@@ -254,6 +255,28 @@ rb_grn_expression_append_operation (VALUE self, VALUE rb_operation,
     n_arguments = NUM2INT(rb_n_arguments);
     grn_expr_append_op(context, expression, operation, n_arguments);
     rb_grn_context_check(context, self);
+    switch (operation) {
+      case GRN_OP_ASSIGN:
+      case GRN_OP_STAR_ASSIGN:
+      case GRN_OP_SLASH_ASSIGN:
+      case GRN_OP_MOD_ASSIGN:
+      case GRN_OP_PLUS_ASSIGN:
+      case GRN_OP_MINUS_ASSIGN:
+      case GRN_OP_SHIFTL_ASSIGN:
+      case GRN_OP_SHIFTR_ASSIGN:
+      case GRN_OP_SHIFTRR_ASSIGN:
+      case GRN_OP_AND_ASSIGN:
+      case GRN_OP_XOR_ASSIGN:
+      case GRN_OP_OR_ASSIGN:
+      case GRN_OP_INCR:
+      case GRN_OP_DECR:
+      case GRN_OP_INCR_POST:
+      case GRN_OP_DECR_POST:
+	rb_iv_set(self, "may_update", Qtrue);
+	break;
+      default:
+	break;
+    }
     return Qnil;
 }
 
@@ -445,6 +468,9 @@ rb_grn_expression_parse (int argc, VALUE *argv, VALUE self)
     if (!NIL_P(exception))
 	rb_exc_raise(exception);
 
+    if ((flags & GRN_EXPR_SYNTAX_SCRIPT) && (flags & GRN_EXPR_ALLOW_UPDATE))
+	rb_iv_set(self, "may_update", Qtrue);
+
     return Qnil;
 }
 
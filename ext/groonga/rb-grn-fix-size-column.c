@@ -80,6 +80,7 @@ rb_grn_fix_size_column_array_set (VALUE self, VALUE rb_id, VALUE rb_value)
     RVAL2GRNBULK_WITH_TYPE(rb_value, context, value, range_id, range);
 
     rc = grn_obj_set_value(context, column, id, value, GRN_OBJ_SET);
+    rb_grn_database_object_modified(column);
     rb_grn_context_check(context, self);
     rb_grn_rc_check(rc, self);
 
@@ -110,6 +111,7 @@ rb_grn_fix_size_column_integer_set (int argc, VALUE *argv, VALUE self, int flags
     RVAL2GRNBULK(rb_delta, context, value);
 
     rc = grn_obj_set_value(context, column, id, value, flags);
+    rb_grn_database_object_modified(column);
     rb_grn_context_check(context, self);
     rb_grn_rc_check(rc, self);
 
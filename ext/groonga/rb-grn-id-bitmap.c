@@ -0,0 +1,845 @@
+/* -*- c-file-style: "ruby" -*- */
+/* vim: set sts=4 sw=4 ts=8 noet: */
+/*
+  Copyright (C) 2011  Kouhei Sutou <kou@clear-code.com>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License version 2.1 as published by the Free Software Foundation.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "rb-grn.h"
+
+#define SELF(object) (rb_rb_grn_id_bitmap_from_ruby_object(object))
+
+/* IDs that have the same upper 16 bits are stored in a
+   container. A container is a sorted array of the lower 16 bits
+   while it has at most RB_GRN_ID_BITMAP_ARRAY_MAX_SIZE IDs and
+   a 65536 bits bitmap after that. */
+#define RB_GRN_ID_BITMAP_ARRAY_MAX_SIZE 4096
+#define RB_GRN_ID_BITMAP_N_WORDS        (65536 / 32)
+
+typedef struct _RbGrnIdBitmapContainer RbGrnIdBitmapContainer;
+struct _RbGrnIdBitmapContainer
+{
+    uint16_t key;
+    unsigned int n_values;
+    unsigned int capacity;
+    uint16_t *values;
+    uint32_t *bits;
+};
+
+typedef struct _RbGrnIdBitmap RbGrnIdBitmap;
+struct _RbGrnIdBitmap
+{
+    RbGrnIdBitmapContainer *containers;
+    unsigned int n_containers;
+    unsigned int capacity;
+};
+
+VALUE rb_cGrnIdBitmap;
+
+/*
+ * Document-class: Groonga::IdBitmap
+ *
+ * レコードIDの集合。検索結果のテーブルと違ってスコアなどは
+ * 持たず、IDがあるかどうかだけを扱う。Roaring bitmapと同じ
+ * ように上位16ビットごとに、IDが少ないときは下位16ビットの
+ * ソート済み配列、多いときはビットマップで格納するので、検
+ * 索結果のテーブルよりもずっと小さく、集合演算も速い。
+ *
+ * Groonga::Table#select や Groonga::Column#select に
+ * +:id_bitmap => true+ を指定すると作られる。
+ * Groonga::Table#intersection! などの集合演算に渡すこともで
+ * きる。
+ */
+
+static RbGrnIdBitmap *
+rb_rb_grn_id_bitmap_from_ruby_object (VALUE object)
+{
+    RbGrnIdBitmap *bitmap;
+
+    if (!RVAL2CBOOL(rb_obj_is_kind_of(object, rb_cGrnIdBitmap))) {
+	rb_raise(rb_eTypeError, "not a groonga ID bitmap: <%s>",
+		 rb_grn_inspect(object));
+    }
+
+    Data_Get_Struct(object, RbGrnIdBitmap, bitmap);
+    return bitmap;
+}
+
+static void
+rb_grn_id_bitmap_container_fin (RbGrnIdBitmapContainer *container)
+{
+    if (container->values)
+	xfree(container->values);
+    if (container->bits)
+	xfree(container->bits);
+}
+
+static void
+rb_grn_id_bitmap_free (void *object)
+{
+    RbGrnIdBitmap *bitmap = object;
+    unsigned int i;
+
+    for (i = 0; i < bitmap->n_containers; i++) {
+	rb_grn_id_bitmap_container_fin(&(bitmap->containers[i]));
+    }
+    if (bitmap->containers)
+	xfree(bitmap->containers);
+    xfree(bitmap);
+}
+
+static VALUE
+rb_grn_id_bitmap_alloc (VALUE klass)
+{
+    RbGrnIdBitmap *bitmap;
+
+    return Data_Make_Struct(klass, RbGrnIdBitmap,
+			    NULL, rb_grn_id_bitmap_free, bitmap);
+}
+
+static unsigned int
+rb_grn_id_bitmap_count_bits (uint32_t word)
+{
+    word = word - ((word >> 1) & 0x55555555);
+    word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+    return (((word + (word >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+}
+
+/* Returns the index of _key_ or the index that _key_ should be
+   inserted with negative sign minus 1. */
+static int
+rb_grn_id_bitmap_search (RbGrnIdBitmap *bitmap, uint16_t key)
+{
+    int low = 0, high = (int)bitmap->n_containers - 1;
+
+    while (low <= high) {
+	int middle = (low + high) / 2;
+	uint16_t middle_key = bitmap->containers[middle].key;
+
+	if (middle_key == key)
+	    return middle;
+	if (middle_key < key)
+	    low = middle + 1;
+	else
+	    high = middle - 1;
+    }
+
+    return -(low + 1);
+}
+
+static int
+rb_grn_id_bitmap_container_search (RbGrnIdBitmapContainer *container,
+				   uint16_t value)
+{
+    int low = 0, high = (int)container->n_values - 1;
+
+    while (low <= high) {
+	int middle = (low + high) / 2;
+	uint16_t middle_value = container->values[middle];
+
+	if (middle_value == value)
+	    return middle;
+	if (middle_value < value)
+	    low = middle + 1;
+	else
+	    high = middle - 1;
+    }
+
+    return -(low + 1);
+}
+
+static grn_bool
+rb_grn_id_bitmap_container_include (RbGrnIdBitmapContainer *container,
+				    uint16_t value)
+{
+    if (container->bits)
+	return (container->bits[value / 32] >> (value % 32)) & 1;
+    return rb_grn_id_bitmap_container_search(container, value) >= 0;
+}
+
+static void
+rb_grn_id_bitmap_container_to_bits (RbGrnIdBitmapContainer *container)
+{
+    unsigned int i;
+
+    container->bits = ALLOC_N(uint32_t, RB_GRN_ID_BITMAP_N_WORDS);
+    MEMZERO(container->bits, uint32_t, RB_GRN_ID_BITMAP_N_WORDS);
+    for (i = 0; i < container->n_values; i++) {
+	uint16_t value = container->values[i];
+	container->bits[value / 32] |= ((uint32_t)1) << (value % 32);
+    }
+    xfree(container->values);
+    container->values = NULL;
+    container->capacity = 0;
+}
+
+static void
+rb_grn_id_bitmap_container_add (RbGrnIdBitmapContainer *container,
+				uint16_t value)
+{
+    int index;
+
+    if (!container->bits &&
+	container->n_values >= RB_GRN_ID_BITMAP_ARRAY_MAX_SIZE)
+	rb_grn_id_bitmap_container_to_bits(container);
+
+    if (container->bits) {
+	uint32_t *word = &(container->bits[value / 32]);
+	uint32_t mask = ((uint32_t)1) << (value % 32);
+
+	if (!(*word & mask)) {
+	    *word |= mask;
+	    container->n_values++;
+	}
+	return;
+    }
+
+    index = rb_grn_id_bitmap_container_search(container, value);
+    if (index >= 0)
+	return;
+    index = -(index + 1);
+    if (container->n_values == container->capacity) {
+	container->capacity =
+	    container->capacity == 0 ? 4 : container->capacity * 2;
+	REALLOC_N(container->values, uint16_t, container->capacity);
+    }
+    memmove(container->values + index + 1, container->values + index,
+	    sizeof(uint16_t) * (container->n_values - index));
+    container->values[index] = value;
+    container->n_values++;
+}
+
+static RbGrnIdBitmapContainer *
+rb_grn_id_bitmap_get_container (RbGrnIdBitmap *bitmap, uint16_t key,
+				grn_bool create)
+{
+    RbGrnIdBitmapContainer *container;
+    int index;
+
+    index = rb_grn_id_bitmap_search(bitmap, key);
+    if (index >= 0)
+	return &(bitmap->containers[index]);
+    if (!create)
+	return NULL;
+
+    index = -(index + 1);
+    if (bitmap->n_containers == bitmap->capacity) {
+	bitmap->capacity = bitmap->capacity == 0 ? 4 : bitmap->capacity * 2;
+	REALLOC_N(bitmap->containers, RbGrnIdBitmapContainer,
+		  bitmap->capacity);
+    }
+    memmove(bitmap->containers + index + 1, bitmap->containers + index,
+	    sizeof(RbGrnIdBitmapContainer) * (bitmap->n_containers - index));
+    bitmap->n_containers++;
+    container = &(bitmap->containers[index]);
+    container->key = key;
+    container->n_values = 0;
+    container->capacity = 0;
+    container->values = NULL;
+    container->bits = NULL;
+    return container;
+}
+
+/* Appends an empty container that must have the largest key. */
+static RbGrnIdBitmapContainer *
+rb_grn_id_bitmap_append_container (RbGrnIdBitmap *bitmap, uint16_t key)
+{
+    return rb_grn_id_bitmap_get_container(bitmap, key, GRN_TRUE);
+}
+
+void
+rb_grn_id_bitmap_add (VALUE self, grn_id id)
+{
+    RbGrnIdBitmapContainer *container;
+
+    container = rb_grn_id_bitmap_get_container(SELF(self), id >> 16,
+					       GRN_TRUE);
+    rb_grn_id_bitmap_container_add(container, id & 0xffff);
+}
+
+grn_bool
+rb_grn_id_bitmap_include (VALUE self, grn_id id)
+{
+    RbGrnIdBitmapContainer *container;
+
+    container = rb_grn_id_bitmap_get_container(SELF(self), id >> 16,
+					       GRN_FALSE);
+    if (!container)
+	return GRN_FALSE;
+    return rb_grn_id_bitmap_container_include(container, id & 0xffff);
+}
+
+VALUE
+rb_grn_id_bitmap_new (void)
+{
+    return rb_grn_id_bitmap_alloc(rb_cGrnIdBitmap);
+}
+
+/*
+ * Returns IDs of _table_ records. If _table_ is a result table,
+ * IDs of records in the source table are used instead.
+ */
+VALUE
+rb_grn_id_bitmap_new_from_table (grn_ctx *context, grn_obj *table)
+{
+    VALUE rb_bitmap;
+    grn_table_cursor *cursor;
+    grn_id id;
+    grn_bool use_key;
+
+    rb_bitmap = rb_grn_id_bitmap_new();
+    use_key = (table->header.flags & GRN_OBJ_WITH_SUBREC) &&
+	table->header.type != GRN_TABLE_NO_KEY;
+    cursor = grn_table_cursor_open(context, table, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    if (!cursor)
+	return rb_bitmap;
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	if (use_key) {
+	    void *key;
+
+	    grn_table_cursor_get_key(context, cursor, &key);
+	    id = *((grn_id *)key);
+	}
+	rb_grn_id_bitmap_add(rb_bitmap, id);
+    }
+    grn_table_cursor_close(context, cursor);
+
+    return rb_bitmap;
+}
+
+/*
+ * Calls _callback_ with each value in _container_ in ascending
+ * order. Stops when _callback_ returns GRN_FALSE.
+ */
+typedef grn_bool (*RbGrnIdBitmapCallback) (uint16_t value, void *user_data);
+
+static grn_bool
+rb_grn_id_bitmap_container_each (RbGrnIdBitmapContainer *container,
+				 RbGrnIdBitmapCallback callback,
+				 void *user_data)
+{
+    unsigned int i;
+
+    if (!container->bits) {
+	for (i = 0; i < container->n_values; i++) {
+	    if (!callback(container->values[i], user_data))
+		return GRN_FALSE;
+	}
+	return GRN_TRUE;
+    }
+
+    for (i = 0; i < RB_GRN_ID_BITMAP_N_WORDS; i++) {
+	uint32_t word = container->bits[i];
+	unsigned int bit = 0;
+
+	while (word) {
+	    if (word & 1) {
+		if (!callback(i * 32 + bit, user_data))
+		    return GRN_FALSE;
+	    }
+	    word >>= 1;
+	    bit++;
+	}
+    }
+    return GRN_TRUE;
+}
+
+typedef struct _RbGrnIdBitmapSetOperationData RbGrnIdBitmapSetOperationData;
+struct _RbGrnIdBitmapSetOperationData
+{
+    RbGrnIdBitmapContainer *other;
+    RbGrnIdBitmapContainer *result;
+    grn_bool include;
+};
+
+static grn_bool
+rb_grn_id_bitmap_set_operation_add (uint16_t value, void *user_data)
+{
+    RbGrnIdBitmapSetOperationData *data = user_data;
+
+    if (!data->other ||
+	rb_grn_id_bitmap_container_include(data->other, value) ==
+	data->include)
+	rb_grn_id_bitmap_container_add(data->result, value);
+    return GRN_TRUE;
+}
+
+static void
+rb_grn_id_bitmap_container_copy (RbGrnIdBitmapContainer *container,
+				 RbGrnIdBitmapContainer *source)
+{
+    container->n_values = source->n_values;
+    if (source->bits) {
+	container->bits = ALLOC_N(uint32_t, RB_GRN_ID_BITMAP_N_WORDS);
+	MEMCPY(container->bits, source->bits, uint32_t,
+	       RB_GRN_ID_BITMAP_N_WORDS);
+    } else if (source->n_values > 0) {
+	container->capacity = source->n_values;
+	container->values = ALLOC_N(uint16_t, container->capacity);
+	MEMCPY(container->values, source->values, uint16_t,
+	       source->n_values);
+    }
+}
+
+/* Stores words of _a_ operator _b_ into _result_. Both _a_ and _b_
+   must be bitmaps. */
+static void
+rb_grn_id_bitmap_container_bits_operation (RbGrnIdBitmapContainer *result,
+					   RbGrnIdBitmapContainer *a,
+					   RbGrnIdBitmapContainer *b,
+					   grn_operator operator)
+{
+    unsigned int i;
+
+    result->bits = ALLOC_N(uint32_t, RB_GRN_ID_BITMAP_N_WORDS);
+    result->n_values = 0;
+    for (i = 0; i < RB_GRN_ID_BITMAP_N_WORDS; i++) {
+	uint32_t word;
+
+	switch (operator) {
+	  case GRN_OP_AND:
+	    word = a->bits[i] & b->bits[i];
+	    break;
+	  case GRN_OP_OR:
+	    word = a->bits[i] | b->bits[i];
+	    break;
+	  default:
+	    word = a->bits[i] & ~(b->bits[i]);
+	    break;
+	}
+	result->bits[i] = word;
+	result->n_values += rb_grn_id_bitmap_count_bits(word);
+    }
+}
+
+static VALUE
+rb_grn_id_bitmap_set_operation (VALUE self, VALUE rb_other,
+				grn_operator operator)
+{
+    RbGrnIdBitmap *bitmap, *other, *result;
+    VALUE rb_result;
+    unsigned int i = 0, j = 0;
+
+    bitmap = SELF(self);
+    other = SELF(rb_other);
+    rb_result = rb_grn_id_bitmap_new();
+    result = SELF(rb_result);
+
+    while (i < bitmap->n_containers || j < other->n_containers) {
+	RbGrnIdBitmapContainer *a = NULL, *b = NULL, *container;
+	RbGrnIdBitmapSetOperationData data;
+
+	if (j == other->n_containers ||
+	    (i < bitmap->n_containers &&
+	     bitmap->containers[i].key < other->containers[j].key)) {
+	    a = &(bitmap->containers[i++]);
+	} else if (i == bitmap->n_containers ||
+		   other->containers[j].key < bitmap->containers[i].key) {
+	    b = &(other->containers[j++]);
+	} else {
+	    a = &(bitmap->containers[i++]);
+	    b = &(other->containers[j++]);
+	}
+
+	if (operator == GRN_OP_AND && !(a && b))
+	    continue;
+	if (operator == GRN_OP_AND_NOT && !a)
+	    continue;
+
+	container = rb_grn_id_bitmap_append_container(result,
+						      a ? a->key : b->key);
+	if (a && b && a->bits && b->bits) {
+	    rb_grn_id_bitmap_container_bits_operation(container, a, b,
+						      operator);
+	} else if (!(a && b)) {
+	    rb_grn_id_bitmap_container_copy(container, a ? a : b);
+	} else if (operator == GRN_OP_OR) {
+	    RbGrnIdBitmapContainer *large, *small;
+
+	    if (a->n_values >= b->n_values) {
+		large = a;
+		small = b;
+	    } else {
+		large = b;
+		small = a;
+	    }
+	    rb_grn_id_bitmap_container_copy(container, large);
+	    data.other = NULL;
+	    data.result = container;
+	    data.include = GRN_TRUE;
+	    rb_grn_id_bitmap_container_each(small,
+					    rb_grn_id_bitmap_set_operation_add,
+					    &data);
+	} else if (operator == GRN_OP_AND) {
+	    if (a->n_values <= b->n_values) {
+		data.other = b;
+		data.result = container;
+		data.include = GRN_TRUE;
+		rb_grn_id_bitmap_container_each(a,
+						rb_grn_id_bitmap_set_operation_add,
+						&data);
+	    } else {
+		data.other = a;
+		data.result = container;
+		data.include = GRN_TRUE;
+		rb_grn_id_bitmap_container_each(b,
+						rb_grn_id_bitmap_set_operation_add,
+						&data);
+	    }
+	} else {
+	    data.other = b;
+	    data.result = container;
+	    data.include = GRN_FALSE;
+	    rb_grn_id_bitmap_container_each(a,
+					    rb_grn_id_bitmap_set_operation_add,
+					    &data);
+	}
+
+	if (container->n_values == 0) {
+	    rb_grn_id_bitmap_container_fin(container);
+	    result->n_containers--;
+	}
+    }
+
+    return rb_result;
+}
+
+/*
+ * call-seq:
+ *   Groonga::IdBitmap.new(ids=[])
+ *
+ * _ids_ のIDを持つ集合を作る。 _ids_ には整数を返す +each+
+ * を持つオブジェクトを指定する。
+ */
+static VALUE
+rb_grn_id_bitmap_initialize (int argc, VALUE *argv, VALUE self)
+{
+    VALUE rb_ids;
+
+    rb_scan_args(argc, argv, "01", &rb_ids);
+
+    if (!NIL_P(rb_ids)) {
+	VALUE rb_array;
+	long i;
+
+	rb_array = rb_funcall(rb_ids, rb_intern("to_a"), 0);
+	for (i = 0; i < RARRAY_LEN(rb_array); i++) {
+	    rb_grn_id_bitmap_add(self, NUM2UINT(RARRAY_PTR(rb_array)[i]));
+	}
+    }
+
+    return Qnil;
+}
+
+/*
+ * call-seq:
+ *   bitmap.add(id) -> bitmap
+ *   bitmap << id -> bitmap
+ *
+ * _id_ を追加する。
+ */
+static VALUE
+rb_grn_id_bitmap_add_id (VALUE self, VALUE rb_id)
+{
+    rb_check_frozen(self);
+    rb_grn_id_bitmap_add(self, NUM2UINT(rb_id));
+    return self;
+}
+
+/*
+ * call-seq:
+ *   bitmap.include?(id) -> true/false
+ *
+ * _id_ を含んでいれば +true+ を返す。
+ */
+static VALUE
+rb_grn_id_bitmap_include_p (VALUE self, VALUE rb_id)
+{
+    return CBOOL2RVAL(rb_grn_id_bitmap_include(self, NUM2UINT(rb_id)));
+}
+
+/*
+ * call-seq:
+ *   bitmap.size -> Integer
+ *
+ * IDの数を返す。
+ */
+static VALUE
+rb_grn_id_bitmap_get_size (VALUE self)
+{
+    RbGrnIdBitmap *bitmap;
+    unsigned int i, size = 0;
+
+    bitmap = SELF(self);
+    for (i = 0; i < bitmap->n_containers; i++) {
+	size += bitmap->containers[i].n_values;
+    }
+
+    return UINT2NUM(size);
+}
+
+/*
+ * call-seq:
+ *   bitmap.empty? -> true/false
+ *
+ * IDを1つも含んでいなければ +true+ を返す。
+ */
+static VALUE
+rb_grn_id_bitmap_empty_p (VALUE self)
+{
+    return CBOOL2RVAL(SELF(self)->n_containers == 0);
+}
+
+/*
+ * call-seq:
+ *   bitmap.memory_size -> Integer
+ *
+ * IDを格納するために使っているメモリのバイト数を返す。
+ */
+static VALUE
+rb_grn_id_bitmap_get_memory_size (VALUE self)
+{
+    RbGrnIdBitmap *bitmap;
+    unsigned int i;
+    size_t size;
+
+    bitmap = SELF(self);
+    size = sizeof(RbGrnIdBitmap) +
+	sizeof(RbGrnIdBitmapContainer) * bitmap->capacity;
+    for (i = 0; i < bitmap->n_containers; i++) {
+	RbGrnIdBitmapContainer *container = &(bitmap->containers[i]);
+
+	if (container->bits)
+	    size += sizeof(uint32_t) * RB_GRN_ID_BITMAP_N_WORDS;
+	else
+	    size += sizeof(uint16_t) * container->capacity;
+    }
+
+    return ULONG2NUM(size);
+}
+
+typedef struct _RbGrnIdBitmapEachData RbGrnIdBitmapEachData;
+struct _RbGrnIdBitmapEachData
+{
+    grn_id high;
+    VALUE rb_array;
+};
+
+static grn_bool
+rb_grn_id_bitmap_each_yield (uint16_t value, void *user_data)
+{
+    RbGrnIdBitmapEachData *data = user_data;
+    grn_id id = data->high | value;
+
+    if (NIL_P(data->rb_array))
+	rb_yield(UINT2NUM(id));
+    else
+	rb_ary_push(data->rb_array, UINT2NUM(id));
+    return GRN_TRUE;
+}
+
+static VALUE
+rb_grn_id_bitmap_each_id (VALUE self, VALUE rb_array)
+{
+    RbGrnIdBitmap *bitmap;
+    RbGrnIdBitmapEachData data;
+    unsigned int i;
+
+    bitmap = SELF(self);
+    data.rb_array = rb_array;
+    for (i = 0; i < bitmap->n_containers; i++) {
+	data.high = ((grn_id)bitmap->containers[i].key) << 16;
+	rb_grn_id_bitmap_container_each(&(bitmap->containers[i]),
+					rb_grn_id_bitmap_each_yield,
+					&data);
+    }
+
+    return self;
+}
+
+typedef struct _RbGrnIdBitmapEachRawData RbGrnIdBitmapEachRawData;
+struct _RbGrnIdBitmapEachRawData
+{
+    grn_id high;
+    RbGrnIdBitmapEachFunction function;
+    void *user_data;
+};
+
+static grn_bool
+rb_grn_id_bitmap_each_raw_call (uint16_t value, void *user_data)
+{
+    RbGrnIdBitmapEachRawData *data = user_data;
+
+    return data->function(data->high | value, data->user_data);
+}
+
+/*
+ * Calls _function_ with each ID in ascending order without
+ * creating Ruby objects. Stops when _function_ returns
+ * GRN_FALSE.
+ */
+void
+rb_grn_id_bitmap_each_raw (VALUE self, RbGrnIdBitmapEachFunction function,
+			   void *user_data)
+{
+    RbGrnIdBitmap *bitmap;
+    RbGrnIdBitmapEachRawData data;
+    unsigned int i;
+
+    bitmap = SELF(self);
+    data.function = function;
+    data.user_data = user_data;
+    for (i = 0; i < bitmap->n_containers; i++) {
+	data.high = ((grn_id)bitmap->containers[i].key) << 16;
+	if (!rb_grn_id_bitmap_container_each(&(bitmap->containers[i]),
+					     rb_grn_id_bitmap_each_raw_call,
+					     &data))
+	    break;
+    }
+}
+
+/*
+ * call-seq:
+ *   bitmap.each {|id| ...}
+ *
+ * IDを昇順にブロックに渡す。ブロックの中でIDを追加してはい
+ * けない。
+ */
+static VALUE
+rb_grn_id_bitmap_each (VALUE self)
+{
+    RETURN_ENUMERATOR(self, 0, NULL);
+
+    return rb_grn_id_bitmap_each_id(self, Qnil);
+}
+
+/*
+ * call-seq:
+ *   bitmap.to_a -> [id, ...]
+ *
+ * IDを昇順に並べた配列を返す。
+ */
+static VALUE
+rb_grn_id_bitmap_to_a (VALUE self)
+{
+    VALUE rb_array;
+
+    rb_array = rb_ary_new();
+    rb_grn_id_bitmap_each_id(self, rb_array);
+    return rb_array;
+}
+
+/*
+ * call-seq:
+ *   bitmap & other -> Groonga::IdBitmap
+ *
+ * _bitmap_ と _other_ の両方に含まれるIDの集合を返す。
+ */
+static VALUE
+rb_grn_id_bitmap_and (VALUE self, VALUE rb_other)
+{
+    return rb_grn_id_bitmap_set_operation(self, rb_other, GRN_OP_AND);
+}
+
+/*
+ * call-seq:
+ *   bitmap | other -> Groonga::IdBitmap
+ *
+ * _bitmap_ と _other_ のどちらかに含まれるIDの集合を返す。
+ */
+static VALUE
+rb_grn_id_bitmap_or (VALUE self, VALUE rb_other)
+{
+    return rb_grn_id_bitmap_set_operation(self, rb_other, GRN_OP_OR);
+}
+
+/*
+ * call-seq:
+ *   bitmap - other -> Groonga::IdBitmap
+ *
+ * _bitmap_ に含まれていて _other_ に含まれていないIDの集合を
+ * 返す。
+ */
+static VALUE
+rb_grn_id_bitmap_minus (VALUE self, VALUE rb_other)
+{
+    return rb_grn_id_bitmap_set_operation(self, rb_other, GRN_OP_AND_NOT);
+}
+
+/*
+ * call-seq:
+ *   bitmap == other -> true/false
+ *
+ * _other_ が同じIDの集合なら +true+ を返す。
+ */
+static VALUE
+rb_grn_id_bitmap_equal (VALUE self, VALUE rb_other)
+{
+    if (!RVAL2CBOOL(rb_obj_is_kind_of(rb_other, rb_cGrnIdBitmap)))
+	return Qfalse;
+
+    return rb_equal(rb_grn_id_bitmap_to_a(self),
+		    rb_grn_id_bitmap_to_a(rb_other));
+}
+
+/*
+ * call-seq:
+ *   bitmap.inspect -> String
+ */
+static VALUE
+rb_grn_id_bitmap_inspect (VALUE self)
+{
+    VALUE inspected;
+
+    inspected = rb_str_new2("#<");
+    rb_str_concat(inspected, rb_inspect(rb_obj_class(self)));
+    rb_str_cat2(inspected, " size: ");
+    rb_str_concat(inspected, rb_inspect(rb_grn_id_bitmap_get_size(self)));
+    rb_str_cat2(inspected, ">");
+
+    return inspected;
+}
+
+void
+rb_grn_init_id_bitmap (VALUE mGrn)
+{
+    rb_cGrnIdBitmap = rb_define_class_under(mGrn, "IdBitmap", rb_cObject);
+    rb_define_alloc_func(rb_cGrnIdBitmap, rb_grn_id_bitmap_alloc);
+
+    rb_include_module(rb_cGrnIdBitmap, rb_mEnumerable);
+
+    rb_define_method(rb_cGrnIdBitmap, "initialize",
+		     rb_grn_id_bitmap_initialize, -1);
+
+    rb_define_method(rb_cGrnIdBitmap, "add", rb_grn_id_bitmap_add_id, 1);
+    rb_define_alias(rb_cGrnIdBitmap, "<<", "add");
+    rb_define_method(rb_cGrnIdBitmap, "include?",
+		     rb_grn_id_bitmap_include_p, 1);
+    rb_define_method(rb_cGrnIdBitmap, "size", rb_grn_id_bitmap_get_size, 0);
+    rb_define_alias(rb_cGrnIdBitmap, "length", "size");
+    rb_define_method(rb_cGrnIdBitmap, "empty?", rb_grn_id_bitmap_empty_p, 0);
+    rb_define_method(rb_cGrnIdBitmap, "memory_size",
+		     rb_grn_id_bitmap_get_memory_size, 0);
+    rb_define_method(rb_cGrnIdBitmap, "each", rb_grn_id_bitmap_each, 0);
+    rb_define_method(rb_cGrnIdBitmap, "to_a", rb_grn_id_bitmap_to_a, 0);
+
+    rb_define_method(rb_cGrnIdBitmap, "&", rb_grn_id_bitmap_and, 1);
+    rb_define_method(rb_cGrnIdBitmap, "|", rb_grn_id_bitmap_or, 1);
+    rb_define_method(rb_cGrnIdBitmap, "-", rb_grn_id_bitmap_minus, 1);
+    rb_define_method(rb_cGrnIdBitmap, "==", rb_grn_id_bitmap_equal, 1);
+
+    rb_define_method(rb_cGrnIdBitmap, "inspect", rb_grn_id_bitmap_inspect, 0);
+}
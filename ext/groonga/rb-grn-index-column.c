@@ -219,6 +219,7 @@ rb_grn_index_column_array_set (VALUE self, VALUE rb_id, VALUE rb_value)
 
     rc = grn_column_index_update(context, column,
 				 id, section, old_value, new_value);
+    rb_grn_database_object_modified(column);
     rb_grn_context_check(context, self);
     rb_grn_rc_check(rc, self);
 
@@ -37,10 +37,57 @@ extern const char *grn_qlog_path;
 
 VALUE cGrnLogger;
 
+#define RB_GRN_LOG_BUFFER_DEFAULT_SIZE 1024
+#define RB_GRN_LOG_BUFFER_DEFAULT_MESSAGE_SIZE 1024
+#define RB_GRN_LOG_BUFFER_TRUNCATED_MARK "..."
+#define RB_GRN_LOG_BUFFER_DEFAULT_INTERVAL 0.1
+
+#ifdef __GNUC__
+#  define RB_GRN_LOG_BUFFER_AVAILABLE
+#  define RB_GRN_LOG_BUFFER_CAS(pointer, old_value, new_value)	\
+    __sync_bool_compare_and_swap(pointer, old_value, new_value)
+#  define RB_GRN_LOG_BUFFER_INCREMENT(pointer)	\
+    __sync_fetch_and_add(pointer, 1)
+#  define RB_GRN_LOG_BUFFER_BARRIER() __sync_synchronize()
+#endif
+
+typedef struct _RbGrnLogEntry RbGrnLogEntry;
+struct _RbGrnLogEntry
+{
+    volatile unsigned long sequence;
+    int level;
+    char time[32];
+    char title[64];
+    char *message;
+    char location[256];
+};
+
+/*
+ * Bounded multi-producer single-consumer queue. Producers are
+ * groonga threads that may not have GVL and the consumer is a
+ * Ruby thread. A producer reserves an entry by CAS on _head_ and
+ * publishes it by setting its _sequence_. Logs are dropped
+ * instead of blocking when the buffer is full.
+ */
+typedef struct _RbGrnLogBuffer RbGrnLogBuffer;
+struct _RbGrnLogBuffer
+{
+    RbGrnLogEntry *entries;
+    unsigned long size;
+    char *messages;
+    size_t message_size;
+    volatile unsigned long head;
+    unsigned long tail;
+    volatile unsigned long n_dropped;
+    grn_bool flushing;
+    double interval;
+};
+
 typedef struct _rb_grn_logger_info_wrapper
 {
     grn_logger_info *logger;
     VALUE handler;
+    RbGrnLogBuffer *buffer;
 } rb_grn_logger_info_wrapper;
 
 static rb_grn_logger_info_wrapper *
@@ -74,11 +121,61 @@ rb_grn_logger_from_ruby_object (VALUE object)
     return wrapper->logger;
 }
 
+/*
+ * Returns true if groonga may call Ruby from its log function.
+ * Groonga::Logger that isn't buffered calls the block in
+ * groonga's log function. Native threads that aren't Ruby
+ * threads must not log while it is registered.
+ */
+grn_bool
+rb_grn_logger_call_ruby_p (void)
+{
+    VALUE current_logger;
+    rb_grn_logger_info_wrapper *wrapper;
+
+    current_logger = rb_cv_get(cGrnLogger, "@@current_logger");
+    if (NIL_P(current_logger))
+	return GRN_FALSE;
+
+    wrapper = RVAL2GRNWRAPPER(current_logger);
+    if (wrapper->buffer || NIL_P(wrapper->handler))
+	return GRN_FALSE;
+
+    return GRN_TRUE;
+}
+
+/*
+ * Raises ArgumentError if groonga may call Ruby from its log
+ * function. It is used before releasing GVL.
+ */
+void
+rb_grn_logger_check_without_gvl (void)
+{
+    VALUE current_logger;
+
+    if (!rb_grn_logger_call_ruby_p())
+	return;
+
+    current_logger = rb_cv_get(cGrnLogger, "@@current_logger");
+    rb_raise(rb_eArgError,
+	     "can't release GVL while Groonga::Logger "
+	     "that isn't buffered is registered: %s",
+	     rb_grn_inspect(current_logger));
+}
+
 static void
 rb_grn_logger_free (void *object)
 {
     rb_grn_logger_info_wrapper *wrapper = object;
 
+    if (!wrapper)
+	return;
+
+    if (wrapper->buffer) {
+	xfree(wrapper->buffer->messages);
+	xfree(wrapper->buffer->entries);
+	xfree(wrapper->buffer);
+    }
     xfree(wrapper->logger);
     xfree(wrapper);
 }
@@ -89,6 +186,9 @@ rb_grn_logger_alloc (VALUE klass)
     return Data_Wrap_Struct(klass, NULL, rb_grn_logger_free, NULL);
 }
 
+static void rb_grn_logger_reset_with_error_check (VALUE klass,
+						  grn_ctx *context);
+
 static grn_log_level
 rb_grn_log_level_from_ruby_object (VALUE rb_level)
 {
@@ -185,6 +285,78 @@ rb_grn_log (int level, const char *time, const char *title,
                rb_str_new2(location));
 }
 
+#ifdef RB_GRN_LOG_BUFFER_AVAILABLE
+/*
+ * Copies _source_ to _destination_. If _source_ doesn't fit into
+ * _size_, it is truncated and ends with
+ * RB_GRN_LOG_BUFFER_TRUNCATED_MARK.
+ */
+static void
+rb_grn_log_buffer_copy (char *destination, const char *source, size_t size)
+{
+    size_t length;
+
+    if (!source) {
+	destination[0] = '\0';
+	return;
+    }
+
+    length = strlen(source);
+    if (length >= size) {
+	size_t mark_length = strlen(RB_GRN_LOG_BUFFER_TRUNCATED_MARK);
+
+	length = size - 1;
+	if (length > mark_length) {
+	    length -= mark_length;
+	    memcpy(destination + length, RB_GRN_LOG_BUFFER_TRUNCATED_MARK,
+		   mark_length);
+	    memcpy(destination, source, length);
+	    destination[length + mark_length] = '\0';
+	    return;
+	}
+    }
+    memcpy(destination, source, length);
+    destination[length] = '\0';
+}
+
+/* This may be called without GVL. Don't use any Ruby API. */
+static void
+rb_grn_log_buffered (int level, const char *time, const char *title,
+		     const char *message, const char *location,
+		     void *func_arg)
+{
+    rb_grn_logger_info_wrapper *wrapper = func_arg;
+    RbGrnLogBuffer *buffer = wrapper->buffer;
+    RbGrnLogEntry *entry;
+    unsigned long position;
+
+    position = buffer->head;
+    for (;;) {
+	long difference;
+
+	entry = &(buffer->entries[position & (buffer->size - 1)]);
+	difference = (long)(entry->sequence - position);
+	if (difference == 0) {
+	    if (RB_GRN_LOG_BUFFER_CAS(&(buffer->head), position, position + 1))
+		break;
+	} else if (difference < 0) {
+	    RB_GRN_LOG_BUFFER_INCREMENT(&(buffer->n_dropped));
+	    return;
+	}
+	position = buffer->head;
+    }
+
+    entry->level = level;
+    rb_grn_log_buffer_copy(entry->time, time, sizeof(entry->time));
+    rb_grn_log_buffer_copy(entry->title, title, sizeof(entry->title));
+    rb_grn_log_buffer_copy(entry->message, message, buffer->message_size);
+    rb_grn_log_buffer_copy(entry->location, location,
+			   sizeof(entry->location));
+    RB_GRN_LOG_BUFFER_BARRIER();
+    entry->sequence = position + 1;
+}
+#endif
+
 static void
 rb_grn_logger_set_handler (VALUE self, VALUE rb_handler)
 {
@@ -200,7 +372,14 @@ rb_grn_logger_set_handler (VALUE self, VALUE rb_handler)
         logger->func = NULL;
         logger->func_arg = NULL;
     } else {
+#ifdef RB_GRN_LOG_BUFFER_AVAILABLE
+	if (wrapper->buffer)
+	    logger->func = rb_grn_log_buffered;
+	else
+	    logger->func = rb_grn_log;
+#else
         logger->func = rb_grn_log;
+#endif
         logger->func_arg = wrapper;
     }
 }
@@ -213,6 +392,7 @@ rb_grn_logger_initialize (int argc, VALUE *argv, VALUE self)
     grn_log_level level;
     int flags = 0;
     VALUE options, rb_level, rb_time, rb_title, rb_message, rb_location;
+    VALUE rb_buffered, rb_buffer_size, rb_message_size, rb_interval;
     VALUE rb_handler;
 
     rb_scan_args(argc, argv, "01&", &options, &rb_handler);
@@ -223,6 +403,10 @@ rb_grn_logger_initialize (int argc, VALUE *argv, VALUE self)
                         "title", &rb_title,
                         "message", &rb_message,
                         "location", &rb_location,
+                        "buffered", &rb_buffered,
+                        "buffer_size", &rb_buffer_size,
+                        "message_size", &rb_message_size,
+                        "interval", &rb_interval,
                         NULL);
 
     level = RVAL2GRNLOGLEVEL(rb_level);
@@ -239,8 +423,53 @@ rb_grn_logger_initialize (int argc, VALUE *argv, VALUE self)
     wrapper = ALLOC(rb_grn_logger_info_wrapper);
     logger = ALLOC(grn_logger_info);
     wrapper->logger = logger;
+    wrapper->buffer = NULL;
     DATA_PTR(self) = wrapper;
 
+    if (RVAL2CBOOL(rb_buffered)) {
+#ifdef RB_GRN_LOG_BUFFER_AVAILABLE
+	RbGrnLogBuffer *buffer;
+	unsigned long i, size = 1, requested_size;
+	size_t message_size;
+
+	requested_size = RB_GRN_LOG_BUFFER_DEFAULT_SIZE;
+	if (!NIL_P(rb_buffer_size))
+	    requested_size = NUM2ULONG(rb_buffer_size);
+	if (requested_size == 0)
+	    rb_raise(rb_eArgError, "buffer size should be positive: %s",
+		     rb_grn_inspect(rb_buffer_size));
+	while (size < requested_size)
+	    size <<= 1;
+	message_size = RB_GRN_LOG_BUFFER_DEFAULT_MESSAGE_SIZE;
+	if (!NIL_P(rb_message_size))
+	    message_size = NUM2ULONG(rb_message_size);
+	if (message_size <= strlen(RB_GRN_LOG_BUFFER_TRUNCATED_MARK))
+	    rb_raise(rb_eArgError, "message size is too small: %s",
+		     rb_grn_inspect(rb_message_size));
+
+	buffer = ALLOC(RbGrnLogBuffer);
+	buffer->entries = ALLOC_N(RbGrnLogEntry, size);
+	buffer->messages = ALLOC_N(char, size * message_size);
+	for (i = 0; i < size; i++) {
+	    buffer->entries[i].sequence = i;
+	    buffer->entries[i].message = buffer->messages + i * message_size;
+	}
+	buffer->size = size;
+	buffer->message_size = message_size;
+	buffer->head = 0;
+	buffer->tail = 0;
+	buffer->n_dropped = 0;
+	buffer->flushing = GRN_FALSE;
+	buffer->interval = RB_GRN_LOG_BUFFER_DEFAULT_INTERVAL;
+	if (!NIL_P(rb_interval))
+	    buffer->interval = NUM2DBL(rb_interval);
+	wrapper->buffer = buffer;
+#else
+	rb_raise(rb_eNotImpError,
+		 "buffered logger isn't available on this platform");
+#endif
+    }
+
     logger->max_level = level;
     logger->flags = flags;
     rb_grn_logger_set_handler(self, rb_handler);
@@ -248,6 +477,180 @@ rb_grn_logger_initialize (int argc, VALUE *argv, VALUE self)
     return Qnil;
 }
 
+#ifdef RB_GRN_LOG_BUFFER_AVAILABLE
+static VALUE
+rb_grn_logger_flush_body (VALUE self)
+{
+    rb_grn_logger_info_wrapper *wrapper;
+    RbGrnLogBuffer *buffer;
+    int n_entries = 0;
+
+    wrapper = RVAL2GRNWRAPPER(self);
+    buffer = wrapper->buffer;
+    for (;;) {
+	RbGrnLogEntry *entry;
+	unsigned long position;
+	VALUE rb_level, rb_time, rb_title, rb_message, rb_location;
+
+	position = buffer->tail;
+	entry = &(buffer->entries[position & (buffer->size - 1)]);
+	if ((long)(entry->sequence - (position + 1)) < 0)
+	    break;
+
+	RB_GRN_LOG_BUFFER_BARRIER();
+	rb_level = GRNLOGLEVEL2RVAL(entry->level);
+	rb_time = rb_str_new2(entry->time);
+	rb_title = rb_str_new2(entry->title);
+	rb_message = rb_str_new2(entry->message);
+	rb_location = rb_str_new2(entry->location);
+	RB_GRN_LOG_BUFFER_BARRIER();
+	entry->sequence = position + buffer->size;
+	buffer->tail = position + 1;
+
+	if (!NIL_P(wrapper->handler))
+	    rb_funcall(wrapper->handler, rb_intern("call"), 5,
+		       rb_level, rb_time, rb_title, rb_message, rb_location);
+	n_entries++;
+    }
+
+    return INT2NUM(n_entries);
+}
+
+static VALUE
+rb_grn_logger_flush_ensure (VALUE self)
+{
+    RVAL2GRNWRAPPER(self)->buffer->flushing = GRN_FALSE;
+    return Qnil;
+}
+#endif
+
+/*
+ * call-seq:
+ *   logger.flush # => 処理したログの数
+ *
+ * バッファリングしているログをすべてブロックに渡す。バッファ
+ * リングしていないロガーでは何もせずに0を返す。
+ *
+ * 通常は +:interval+ 毎に自動で呼ばれるので明示的に呼ぶ必要
+ * はない。
+ */
+static VALUE
+rb_grn_logger_flush (VALUE self)
+{
+#ifdef RB_GRN_LOG_BUFFER_AVAILABLE
+    RbGrnLogBuffer *buffer;
+
+    buffer = RVAL2GRNWRAPPER(self)->buffer;
+    if (!buffer || buffer->flushing)
+	return INT2NUM(0);
+
+    buffer->flushing = GRN_TRUE;
+    return rb_ensure(rb_grn_logger_flush_body, self,
+		     rb_grn_logger_flush_ensure, self);
+#else
+    return INT2NUM(0);
+#endif
+}
+
+/*
+ * call-seq:
+ *   logger.n_dropped # => バッファが一杯で捨てたログの数
+ *
+ * バッファが一杯だったためにブロックに渡せなかったログの数を
+ * 返す。バッファリングしていないロガーでは常に0を返す。
+ */
+static VALUE
+rb_grn_logger_get_n_dropped (VALUE self)
+{
+#ifdef RB_GRN_LOG_BUFFER_AVAILABLE
+    RbGrnLogBuffer *buffer;
+
+    buffer = RVAL2GRNWRAPPER(self)->buffer;
+    if (buffer)
+	return ULONG2NUM(buffer->n_dropped);
+#endif
+    return INT2NUM(0);
+}
+
+/*
+ * call-seq:
+ *   logger.level # => Symbol
+ *
+ * ブロックに渡すログの最低のレベルを返す。
+ */
+static VALUE
+rb_grn_logger_get_level (VALUE self)
+{
+    return GRNLOGLEVEL2RVAL(RVAL2GRNLOGGER(self)->max_level);
+}
+
+/*
+ * call-seq:
+ *   logger.handler # => Proc
+ *
+ * ログを渡すブロックを返す。
+ */
+static VALUE
+rb_grn_logger_get_handler (VALUE self)
+{
+    return rb_iv_get(self, "@handler");
+}
+
+/*
+ * call-seq:
+ *   logger.buffered?
+ *
+ * ログをバッファリングしている場合は +true+ を返す。
+ */
+static VALUE
+rb_grn_logger_buffered_p (VALUE self)
+{
+    return CBOOL2RVAL(RVAL2GRNWRAPPER(self)->buffer != NULL);
+}
+
+#ifdef RB_GRN_LOG_BUFFER_AVAILABLE
+static VALUE
+rb_grn_logger_flush_loop_rescue (VALUE self, VALUE exception)
+{
+    rb_warn("failed to pass buffered log: %s", rb_grn_inspect(exception));
+    return Qnil;
+}
+
+static VALUE
+rb_grn_logger_flush_loop (void *data)
+{
+    VALUE self = (VALUE)data;
+    double interval;
+    struct timeval timeout;
+
+    interval = RVAL2GRNWRAPPER(self)->buffer->interval;
+    timeout.tv_sec = (time_t)interval;
+    timeout.tv_usec = (long)((interval - timeout.tv_sec) * 1000000);
+    for (;;) {
+	rb_thread_wait_for(timeout);
+	/* An exception from the block must not stop the thread. */
+	rb_rescue(rb_grn_logger_flush, self,
+		  rb_grn_logger_flush_loop_rescue, self);
+    }
+
+    return Qnil;
+}
+#endif
+
+static void
+rb_grn_logger_stop_flush_thread (VALUE self)
+{
+    VALUE rb_thread;
+
+    rb_thread = rb_iv_get(self, "@flush_thread");
+    if (NIL_P(rb_thread))
+	return;
+
+    rb_iv_set(self, "@flush_thread", Qnil);
+    rb_funcall(rb_thread, rb_intern("kill"), 0);
+    rb_funcall(rb_thread, rb_intern("join"), 0);
+}
+
 /*
  * call-seq:
  *   Groonga::Logger.register(options={})
@@ -293,19 +696,92 @@ rb_grn_logger_initialize (int argc, VALUE *argv, VALUE self)
  *   ログの発生元のプロセスIDとgroongaのソースコードのファイ
  *   ル名、行番号、関数名をブロックに渡したいなら +true+ を指
  *   定する。デフォルトでは渡す。
+ *
+ * @option options :buffered
+ *
+ *   +true+ を指定するとログを固定長のリングバッファに書き込
+ *   み、Rubyのスレッドからまとめてブロックに渡す。groongaの
+ *   ログ出力処理でRubyのAPIを呼ばなくなるので、GVLを持たない
+ *   スレッドからログが出力されても安全になる。バッファが一杯
+ *   のときはログを捨て、捨てた数は Groonga::Logger#n_dropped
+ *   で取得できる。各文字列は固定長に切り詰められ、切り詰め
+ *   られた文字列の末尾は "..." になる。ブロックで発生した例
+ *   外は警告として出力され、以降のログも引き続きブロックに
+ *   渡される。デフォルトではバッファリングしない。
+ *
+ * @option options :buffer_size
+ *
+ *   +:buffered+ のときにバッファできるログの数。2の累乗に切
+ *   り上げられる。デフォルトでは1024。
+ *
+ * @option options :message_size
+ *
+ *   +:buffered+ のときにバッファできるメッセージの最大バイト
+ *   数。終端の分も含む。デフォルトでは1024。
+ *
+ * @option options :interval
+ *
+ *   +:buffered+ のときにバッファをブロックに渡す間隔(秒)。
+ *   デフォルトでは0.1。
+ *
+ * @return [Groonga::Logger] 登録したロガー。
  */
 static VALUE
 rb_grn_logger_s_register (int argc, VALUE *argv, VALUE klass)
 {
-    VALUE logger, rb_context = Qnil;
-    grn_ctx *context;
+    VALUE logger;
 
     logger = rb_funcall2(klass, rb_intern("new"), argc, argv);
     rb_grn_logger_set_handler(logger, rb_block_proc());
+    rb_funcall(klass, rb_intern("current="), 1, logger);
+
+    return logger;
+}
+
+/*
+ * call-seq:
+ *   Groonga::Logger.current # => Groonga::Logger or nil
+ *
+ * Groonga::Logger.registerで登録されているロガーを返す。
+ * groongaのデフォルトロガーを使っている場合は +nil+ を返す。
+ */
+static VALUE
+rb_grn_logger_s_get_current (VALUE klass)
+{
+    return rb_cv_get(klass, "@@current_logger");
+}
+
+/*
+ * call-seq:
+ *   Groonga::Logger.current = logger
+ *
+ * _logger_ をgroongaのロガーとして登録する。
+ * Groonga::Logger.registerで登録していたロガーに戻すときに
+ * 使う。 +nil+ を指定するとgroongaのデフォルトロガーに戻す。
+ */
+static VALUE
+rb_grn_logger_s_set_current (VALUE klass, VALUE rb_logger)
+{
+    VALUE rb_context = Qnil;
+    grn_ctx *context;
+
+    if (!NIL_P(rb_logger))
+	RVAL2GRNWRAPPER(rb_logger);
     context = rb_grn_context_ensure(&rb_context);
-    grn_logger_info_set(context, RVAL2GRNLOGGER(logger));
-    rb_grn_context_check(context, logger);
-    rb_cv_set(klass, "@@current_logger", logger);
+    rb_grn_logger_reset_with_error_check(klass, context);
+    if (NIL_P(rb_logger))
+	return Qnil;
+
+    grn_logger_info_set(context, RVAL2GRNLOGGER(rb_logger));
+    rb_grn_context_check(context, rb_logger);
+    rb_cv_set(klass, "@@current_logger", rb_logger);
+#ifdef RB_GRN_LOG_BUFFER_AVAILABLE
+    if (RVAL2GRNWRAPPER(rb_logger)->buffer) {
+	rb_iv_set(rb_logger, "@flush_thread",
+		  rb_thread_create(rb_grn_logger_flush_loop,
+				   (void *)rb_logger));
+    }
+#endif
 
     return Qnil;
 }
@@ -320,11 +796,14 @@ rb_grn_logger_reset_with_error_check (VALUE klass, grn_ctx *context)
         return;
 
     rb_cv_set(klass, "@@current_logger", Qnil);
+    rb_grn_logger_stop_flush_thread(current_logger);
     if (context) {
 	grn_logger_info_set(context, NULL);
+	rb_grn_logger_flush(current_logger);
 	rb_grn_context_check(context, current_logger);
     } else {
 	grn_logger_info_set(NULL, NULL);
+	rb_grn_logger_flush(current_logger);
     }
 }
 
@@ -334,6 +813,20 @@ rb_grn_logger_reset (VALUE klass)
     rb_grn_logger_reset_with_error_check(klass, NULL);
 }
 
+/*
+ * call-seq:
+ *   Groonga::Logger.unregister
+ *
+ * Groonga::Logger.registerで登録したロガーの登録を解除し、
+ * groongaのデフォルトロガーに戻す。バッファリングしているロ
+ * ガーの場合は残っているログをブロックに渡してから解除する。
+ */
+static VALUE
+rb_grn_logger_s_unregister (VALUE klass)
+{
+    return rb_grn_logger_s_set_current(klass, Qnil);
+}
+
 static VALUE
 rb_grn_logger_s_reopen_with_related_object (VALUE klass, VALUE related_object)
 {
@@ -493,6 +986,12 @@ rb_grn_init_logger (VALUE mGrn)
     rb_cv_set(cGrnLogger, "@@query_log_path", Qnil);
     rb_define_singleton_method(cGrnLogger, "register",
                                rb_grn_logger_s_register, -1);
+    rb_define_singleton_method(cGrnLogger, "unregister",
+                               rb_grn_logger_s_unregister, 0);
+    rb_define_singleton_method(cGrnLogger, "current",
+                               rb_grn_logger_s_get_current, 0);
+    rb_define_singleton_method(cGrnLogger, "current=",
+                               rb_grn_logger_s_set_current, 1);
     rb_define_singleton_method(cGrnLogger, "reopen",
                                rb_grn_logger_s_reopen, 0);
     rb_define_singleton_method(cGrnLogger, "log_path",
@@ -506,4 +1005,9 @@ rb_grn_init_logger (VALUE mGrn)
     rb_set_end_proc(rb_grn_logger_reset, cGrnLogger);
 
     rb_define_method(cGrnLogger, "initialize", rb_grn_logger_initialize, -1);
+    rb_define_method(cGrnLogger, "flush", rb_grn_logger_flush, 0);
+    rb_define_method(cGrnLogger, "n_dropped", rb_grn_logger_get_n_dropped, 0);
+    rb_define_method(cGrnLogger, "level", rb_grn_logger_get_level, 0);
+    rb_define_method(cGrnLogger, "handler", rb_grn_logger_get_handler, 0);
+    rb_define_method(cGrnLogger, "buffered?", rb_grn_logger_buffered_p, 0);
 }
@@ -1254,6 +1254,45 @@ rb_grn_object_array_reference (VALUE self, VALUE rb_id)
     return rb_value;
 }
 
+/*
+ * Returns GRN_TRUE when _rb_value_ is a binary String that has
+ * packed record IDs for a vector reference column. It can be
+ * created by <tt>ids.pack("I*")</tt>.
+ */
+static grn_bool
+rb_packed_uvector_value_p (RbGrnObject *rb_grn_object, VALUE rb_value)
+{
+    grn_obj *object = rb_grn_object->object;
+
+    if (TYPE(rb_value) != T_STRING)
+	return GRN_FALSE;
+#ifdef HAVE_RUBY_ENCODING_H
+    if (rb_enc_get(rb_value) != rb_ascii8bit_encoding())
+	return GRN_FALSE;
+#else
+    return GRN_FALSE;
+#endif
+    if (RSTRING_LEN(rb_value) % sizeof(grn_id) != 0)
+	return GRN_FALSE;
+    if (!(object->header.type == GRN_COLUMN_FIX_SIZE ||
+	  object->header.type == GRN_COLUMN_VAR_SIZE))
+	return GRN_FALSE;
+    if ((object->header.flags & GRN_OBJ_COLUMN_TYPE_MASK) !=
+	GRN_OBJ_COLUMN_VECTOR)
+	return GRN_FALSE;
+    if (!rb_grn_object->range)
+	return GRN_FALSE;
+
+    switch (rb_grn_object->range->header.type) {
+      case GRN_TABLE_HASH_KEY:
+      case GRN_TABLE_PAT_KEY:
+      case GRN_TABLE_NO_KEY:
+	return GRN_TRUE;
+      default:
+	return GRN_FALSE;
+    }
+}
+
 static grn_bool
 rb_uvector_value_p (RbGrnObject *rb_grn_object, VALUE rb_value)
 {
@@ -1273,7 +1312,8 @@ rb_uvector_value_p (RbGrnObject *rb_grn_object, VALUE rb_value)
       case GRN_TABLE_NO_KEY:
       case GRN_TABLE_VIEW:
 	first_element = rb_ary_entry(rb_value, 0);
-	if (rb_respond_to(first_element, rb_intern("record_raw_id"))) {
+	if (CLASS_OF(first_element) == rb_cGrnRecord ||
+	    rb_respond_to(first_element, rb_intern("record_raw_id"))) {
 	    return GRN_TRUE;
 	}
 	break;
@@ -1295,7 +1335,12 @@ rb_grn_object_set_raw (RbGrnObject *rb_grn_object, grn_id id,
 
     context = rb_grn_object->context;
     rb_values = rb_check_array_type(rb_value);
-    if (NIL_P(rb_values)) {
+    if (rb_packed_uvector_value_p(rb_grn_object, rb_value)) {
+	GRN_OBJ_INIT(&value, GRN_UVECTOR, 0,
+		     rb_grn_object->object->header.domain);
+	grn_bulk_write(context, &value,
+		       RSTRING_PTR(rb_value), RSTRING_LEN(rb_value));
+    } else if (NIL_P(rb_values)) {
 	if (NIL_P(rb_value)) {
 	    GRN_OBJ_INIT(&value, GRN_BULK, 0, GRN_ID_NIL);
 	} else {
@@ -1314,6 +1359,7 @@ rb_grn_object_set_raw (RbGrnObject *rb_grn_object, grn_id id,
     }
     rc = grn_obj_set_value(context, rb_grn_object->object, id,
 			   &value, flags);
+    rb_grn_database_object_modified(rb_grn_object->object);
     exception = rb_grn_context_to_exception(context, related_object);
     grn_obj_unlink(context, &value);
     if (!NIL_P(exception))
@@ -1403,6 +1449,8 @@ rb_grn_object_remove (VALUE self)
 
     context = rb_grn_object->context;
     rc = grn_obj_remove(context, rb_grn_object->object);
+    rb_grn_database_modified();
+    rb_grn_database_schema_modified();
     rb_grn_rc_check(rc, self);
 
     rb_iv_set(self, "@context", Qnil);
@@ -194,6 +194,8 @@ rb_grn_table_cursor_delete (VALUE self)
     if (context && cursor) {
         grn_rc rc;
 
+        rb_grn_database_object_modified(grn_table_cursor_table(context,
+                                                               cursor));
         rc = grn_table_cursor_delete(context, cursor);
         rb_grn_rc_check(rc, self);
     }
@@ -95,6 +95,7 @@ rb_grn_table_key_support_add_raw (VALUE self, VALUE rb_key, int *added)
     grn_id id, domain_id;
     grn_obj *key, *domain;
 
+    rb_check_frozen(self);
     rb_grn_table_key_support_deconstruct(SELF(self), &table, &context,
 					 &key, &domain_id, &domain,
 					 NULL, NULL, NULL,
@@ -104,6 +105,7 @@ rb_grn_table_key_support_add_raw (VALUE self, VALUE rb_key, int *added)
     RVAL2GRNKEY(rb_key, context, key, domain_id, domain, self);
     id = grn_table_add(context, table,
                        GRN_BULK_HEAD(key), GRN_BULK_VSIZE(key), added);
+    rb_grn_database_object_modified(table);
     rb_grn_context_check(context, self);
 
     return id;
@@ -267,6 +269,7 @@ rb_grn_table_key_support_delete_by_key (VALUE self, VALUE rb_key)
     grn_obj *key, *domain;
     grn_rc rc;
 
+    rb_check_frozen(self);
     rb_grn_table_key_support_deconstruct(SELF(self), &table, &context,
 					 &key, &domain_id, &domain,
 					 NULL, NULL, NULL,
@@ -276,6 +279,7 @@ rb_grn_table_key_support_delete_by_key (VALUE self, VALUE rb_key)
     RVAL2GRNKEY(rb_key, context, key, domain_id, domain, self);
     rc = grn_table_delete(context, table,
 			  GRN_BULK_HEAD(key), GRN_BULK_VSIZE(key));
+    rb_grn_database_object_modified(table);
     rb_grn_context_check(context, self);
     rb_grn_rc_check(rc, self);
 
@@ -406,6 +410,7 @@ rb_grn_table_key_support_set_column_value (int argc, VALUE *argv, VALUE self)
     grn_id id;
     VALUE rb_key, rb_id_or_key, rb_name, rb_value, rb_options;
 
+    rb_check_frozen(self);
     rb_scan_args(argc, argv, "31",
 		 &rb_id_or_key, &rb_name, &rb_value, &rb_options);
     if (!NIL_P(rb_options)) {
@@ -436,9 +441,13 @@ rb_grn_table_key_support_set_column_value (int argc, VALUE *argv, VALUE self)
  * call-seq:
  *   table.column_value(key, name)
  *   table.column_value(id, name, :id => true)
+ *   table.column_value(key, name, options)
  *
  * _table_ の _key_ に対応するカラム _name_ の値を設定する。
  *
+ * _options_ の<tt>:ids</tt>、<tt>:packed</tt>、
+ * <tt>:weight</tt>はGroonga::Table#column_valueと同じ。
+ *
  * TODO: _key_ に対応するレコードがない場合は例外？
  */
 static VALUE
@@ -446,25 +455,32 @@ rb_grn_table_key_support_get_column_value (int argc, VALUE *argv, VALUE self)
 {
     grn_id id;
     VALUE rb_key, rb_id_or_key, rb_name, rb_options;
+    VALUE rb_option_id = Qnil, rb_option_ids, rb_option_packed;
+    VALUE rb_option_weight;
 
     rb_scan_args(argc, argv, "21", &rb_id_or_key, &rb_name, &rb_options);
     if (!NIL_P(rb_options)) {
-	VALUE rb_option_id;
 	rb_grn_scan_options(rb_options,
 			    "id", &rb_option_id,
+			    "ids", &rb_option_ids,
+			    "packed", &rb_option_packed,
+			    "weight", &rb_option_weight,
 			    NULL);
-	if (RVAL2CBOOL(rb_option_id)) {
-	    VALUE rb_id = rb_id_or_key;
-	    return rb_grn_table_get_column_value(self, rb_id, rb_name);
-	}
     }
 
-    rb_key = rb_id_or_key;
-    id = rb_grn_table_key_support_get(self, rb_key);
-    if (id == GRN_ID_NIL) {
-	return Qnil;
+    if (RVAL2CBOOL(rb_option_id)) {
+	id = NUM2UINT(rb_id_or_key);
+    } else {
+	rb_key = rb_id_or_key;
+	id = rb_grn_table_key_support_get(self, rb_key);
+	if (id == GRN_ID_NIL) {
+	    return Qnil;
+	}
     }
 
+    if (!NIL_P(rb_options))
+	return rb_grn_table_get_column_value_with_options(self, id, rb_name,
+							  rb_options);
     return rb_grn_table_get_column_value_raw(self, id, rb_name);
 }
 
@@ -534,6 +550,7 @@ rb_grn_table_key_support_set_value_by_key (VALUE self,
     grn_obj *value;
     grn_rc rc;
 
+    rb_check_frozen(self);
     if (NIL_P(rb_key)) {
 	rb_raise(rb_eArgError, "key should not be nil: <%s>",
 		 rb_grn_inspect(self));
@@ -555,6 +572,7 @@ rb_grn_table_key_support_set_value_by_key (VALUE self,
     GRN_BULK_REWIND(value);
     RVAL2GRNBULK(rb_value, context, value);
     rc = grn_obj_set_value(context, table, id, value, GRN_OBJ_SET);
+    rb_grn_database_object_modified(table);
     rb_grn_context_check(context, self);
     rb_grn_rc_check(rc, self);
 
@@ -333,6 +333,7 @@ rb_grn_table_define_column (int argc, VALUE *argv, VALUE self)
 	rb_grn_context_check(context,
 			     rb_ary_new3(2, self, rb_ary_new4(argc, argv)));
     }
+    rb_grn_database_schema_modified();
 
     rb_column = GRNCOLUMN2RVAL(Qnil, context, column, GRN_TRUE);
     rb_ary_push(columns, rb_column);
@@ -484,6 +485,7 @@ rb_grn_table_define_index_column (int argc, VALUE *argv, VALUE self)
 	rb_grn_context_check(context,
 			     rb_ary_new3(2, self, rb_ary_new4(argc, argv)));
     }
+    rb_grn_database_schema_modified();
 
     rb_column = GRNCOLUMN2RVAL(Qnil, context, column, GRN_TRUE);
     if (!NIL_P(rb_source))
@@ -873,6 +875,30 @@ rb_grn_table_get_size (VALUE self)
     return UINT2NUM(size);
 }
 
+/*
+ * call-seq:
+ *   table.to_id_bitmap -> Groonga::IdBitmap
+ *
+ * テーブルのレコードのIDを持つGroonga::IdBitmapを返す。検
+ * 索結果のテーブルの場合は検索対象のテーブルのレコードのID
+ * を持つ。
+ */
+static VALUE
+rb_grn_table_to_id_bitmap (VALUE self)
+{
+    grn_ctx *context = NULL;
+    grn_obj *table;
+    VALUE rb_bitmap;
+
+    rb_grn_table_deconstruct(SELF(self), &table, &context,
+			     NULL, NULL,
+			     NULL, NULL, NULL,
+			     NULL);
+    rb_bitmap = rb_grn_id_bitmap_new_from_table(context, table);
+    rb_grn_context_check(context, self);
+    return rb_bitmap;
+}
+
 /*
  * call-seq:
  *   table.empty? -> true/false
@@ -907,11 +933,13 @@ rb_grn_table_truncate (VALUE self)
     grn_obj *table;
     grn_rc rc;
 
+    rb_check_frozen(self);
     rb_grn_table_deconstruct(SELF(self), &table, &context,
 			     NULL, NULL,
 			     NULL, NULL, NULL,
 			     NULL);
     rc = grn_table_truncate(context, table);
+    rb_grn_database_object_modified(table);
     rb_grn_rc_check(rc, self);
 
     return Qnil;
@@ -966,6 +994,7 @@ rb_grn_table_delete (VALUE self, VALUE rb_id)
     grn_id id;
     grn_rc rc;
 
+    rb_check_frozen(self);
     rb_grn_table_deconstruct(SELF(self), &table, &context,
 			     NULL, NULL,
 			     NULL, NULL, NULL,
@@ -973,11 +1002,76 @@ rb_grn_table_delete (VALUE self, VALUE rb_id)
 
     id = NUM2UINT(rb_id);
     rc = grn_table_delete_by_id(context, table, id);
+    rb_grn_database_object_modified(table);
     rb_grn_rc_check(rc, self);
 
     return Qnil;
 }
 
+static void
+rb_grn_table_sort_keys_fill (VALUE self, grn_ctx *context,
+			     grn_table_sort_key *keys, int n_keys,
+			     VALUE *rb_sort_keys)
+{
+    int i;
+
+    for (i = 0; i < n_keys; i++) {
+	VALUE rb_sort_options, rb_key, rb_resolved_key, rb_order;
+
+	if (RVAL2CBOOL(rb_obj_is_kind_of(rb_sort_keys[i], rb_cHash))) {
+	    rb_sort_options = rb_sort_keys[i];
+	} else if (RVAL2CBOOL(rb_obj_is_kind_of(rb_sort_keys[i], rb_cArray))) {
+	    rb_sort_options = rb_hash_new();
+	    rb_hash_aset(rb_sort_options,
+			 RB_GRN_INTERN("key"),
+			 rb_ary_entry(rb_sort_keys[i], 0));
+	    rb_hash_aset(rb_sort_options,
+			 RB_GRN_INTERN("order"),
+			 rb_ary_entry(rb_sort_keys[i], 1));
+	} else {
+	    rb_sort_options = rb_hash_new();
+	    rb_hash_aset(rb_sort_options,
+			 RB_GRN_INTERN("key"),
+			 rb_sort_keys[i]);
+	}
+	rb_grn_scan_options(rb_sort_options,
+			    "key", &rb_key,
+			    "order", &rb_order,
+			    NULL);
+	if (RVAL2CBOOL(rb_obj_is_kind_of(rb_key, rb_cString))) {
+	    rb_resolved_key = rb_grn_table_get_column(self, rb_key);
+	} else {
+	    rb_resolved_key = rb_key;
+	}
+	keys[i].key = RVAL2GRNOBJECT(rb_resolved_key, &context);
+	if (!keys[i].key) {
+	    rb_raise(rb_eGrnNoSuchColumn,
+		     "no such column: <%s>: <%s>",
+		     rb_grn_inspect(rb_key), rb_grn_inspect(self));
+	}
+	if (NIL_P(rb_order) ||
+	    rb_grn_equal_option(rb_order, "asc") ||
+	    rb_grn_equal_option(rb_order, "ascending")) {
+	    keys[i].flags = GRN_TABLE_SORT_ASC;
+	} else if (rb_grn_equal_option(rb_order, "desc") ||
+		   rb_grn_equal_option(rb_order, "descending")) {
+	    keys[i].flags = GRN_TABLE_SORT_DESC;
+	} else {
+	    rb_raise(rb_eArgError,
+		     "order should be one of "
+		     "[nil, :desc, :descending, :asc, :ascending]: %s",
+		     rb_grn_inspect(rb_order));
+	}
+    }
+}
+
+static grn_bool rb_grn_table_top_k_fixed_size_type_p (grn_id type_id);
+static VALUE rb_grn_table_sort_parallel (grn_ctx *context, grn_obj *table,
+					 grn_table_sort_key *keys,
+					 grn_id *types,
+					 int n_keys, int offset, int limit,
+					 int n_workers, VALUE self);
+
 /*
  * call-seq:
  *   table.sort(keys, options={}) -> Groonga::Recordの配列
@@ -1031,6 +1125,20 @@ rb_grn_table_delete (VALUE self, VALUE rb_id)
  *   ソートされたレコードのうち、 _:limit_ 件のみを取り出す。
  *   省略された場合または-1が指定された場合は、全件が指定され
  *   たものとみなす。
+ *
+ * @option options :parallel The parallel
+ *   ソートに使うスレッド数。2以上を指定するとレコードを
+ *   _:parallel_ 個に分割してそれぞれのスレッドでソートし、
+ *   最後にマージする。64より大きい値は64とみなす。ソート
+ *   キーが全て数値またはTimeのカラム（ +_score+ などを含む）
+ *   の場合だけ有効で、それ以外の場合は無視される。同じ値の
+ *   レコードはIDの昇順に並ぶ。
+ *
+ *   並列になるのはメモリ上でのソートとマージだけで、ソート
+ *   キーの値は最初に1つのスレッドで全レコード分読み込む。そ
+ *   のため、大きなテーブルを _:limit_ なしでソートし、比較
+ *   のコストが読み込みのコストより大きい場合にだけ速くなる。
+ *   少数の上位レコードだけが欲しい場合は #top_k を使うこと。
  */
 static VALUE
 rb_grn_table_sort (int argc, VALUE *argv, VALUE self)
@@ -1039,10 +1147,10 @@ rb_grn_table_sort (int argc, VALUE *argv, VALUE self)
     grn_obj *table;
     grn_obj *result;
     grn_table_sort_key *keys;
-    int i, n_keys;
-    int offset = 0, limit = -1;
+    int n_keys;
+    int offset = 0, limit = -1, n_workers = 1;
     VALUE rb_keys, options;
-    VALUE rb_offset, rb_limit;
+    VALUE rb_offset, rb_limit, rb_parallel;
     VALUE *rb_sort_keys;
     grn_table_cursor *cursor;
     VALUE rb_result;
@@ -1062,64 +1170,43 @@ rb_grn_table_sort (int argc, VALUE *argv, VALUE self)
     n_keys = RARRAY_LEN(rb_keys);
     rb_sort_keys = RARRAY_PTR(rb_keys);
     keys = ALLOCA_N(grn_table_sort_key, n_keys);
-    for (i = 0; i < n_keys; i++) {
-	VALUE rb_sort_options, rb_key, rb_resolved_key, rb_order;
-
-	if (RVAL2CBOOL(rb_obj_is_kind_of(rb_sort_keys[i], rb_cHash))) {
-	    rb_sort_options = rb_sort_keys[i];
-	} else if (RVAL2CBOOL(rb_obj_is_kind_of(rb_sort_keys[i], rb_cArray))) {
-	    rb_sort_options = rb_hash_new();
-	    rb_hash_aset(rb_sort_options,
-			 RB_GRN_INTERN("key"),
-			 rb_ary_entry(rb_sort_keys[i], 0));
-	    rb_hash_aset(rb_sort_options,
-			 RB_GRN_INTERN("order"),
-			 rb_ary_entry(rb_sort_keys[i], 1));
-	} else {
-	    rb_sort_options = rb_hash_new();
-	    rb_hash_aset(rb_sort_options,
-			 RB_GRN_INTERN("key"),
-			 rb_sort_keys[i]);
-	}
-	rb_grn_scan_options(rb_sort_options,
-			    "key", &rb_key,
-			    "order", &rb_order,
-			    NULL);
-	if (RVAL2CBOOL(rb_obj_is_kind_of(rb_key, rb_cString))) {
-	    rb_resolved_key = rb_grn_table_get_column(self, rb_key);
-	} else {
-	    rb_resolved_key = rb_key;
-	}
-	keys[i].key = RVAL2GRNOBJECT(rb_resolved_key, &context);
-	if (!keys[i].key) {
-	    rb_raise(rb_eGrnNoSuchColumn,
-		     "no such column: <%s>: <%s>",
-		     rb_grn_inspect(rb_key), rb_grn_inspect(self));
-	}
-	if (NIL_P(rb_order) ||
-	    rb_grn_equal_option(rb_order, "asc") ||
-	    rb_grn_equal_option(rb_order, "ascending")) {
-	    keys[i].flags = GRN_TABLE_SORT_ASC;
-	} else if (rb_grn_equal_option(rb_order, "desc") ||
-		   rb_grn_equal_option(rb_order, "descending")) {
-	    keys[i].flags = GRN_TABLE_SORT_DESC;
-	} else {
-	    rb_raise(rb_eArgError,
-		     "order should be one of "
-		     "[nil, :desc, :descending, :asc, :ascending]: %s",
-		     rb_grn_inspect(rb_order));
-	}
-    }
+    rb_grn_table_sort_keys_fill(self, context, keys, n_keys, rb_sort_keys);
 
     rb_grn_scan_options(options,
 			"offset", &rb_offset,
 			"limit", &rb_limit,
+			"parallel", &rb_parallel,
 			NULL);
 
     if (!NIL_P(rb_offset))
 	offset = NUM2INT(rb_offset);
     if (!NIL_P(rb_limit))
 	limit = NUM2INT(rb_limit);
+    if (!NIL_P(rb_parallel))
+	n_workers = NUM2INT(rb_parallel);
+    if (n_workers > RB_GRN_MAX_WORKERS)
+	n_workers = RB_GRN_MAX_WORKERS;
+
+    if (n_workers > 1 && offset >= 0) {
+	grn_id *types;
+	grn_bool fixed_size_p = GRN_TRUE;
+	int i;
+
+	types = ALLOCA_N(grn_id, n_keys);
+	for (i = 0; i < n_keys; i++) {
+	    types[i] = grn_obj_get_range(context, keys[i].key);
+	    if (!rb_grn_table_top_k_fixed_size_type_p(types[i]))
+		fixed_size_p = GRN_FALSE;
+	}
+	if (fixed_size_p) {
+	    rb_result = rb_grn_table_sort_parallel(context, table,
+						   keys, types, n_keys,
+						   offset, limit,
+						   n_workers, self);
+	    rb_grn_context_check(context, self);
+	    return rb_result;
+	}
+    }
 
     result = grn_table_create(context, NULL, 0, NULL, GRN_TABLE_NO_KEY,
 			      NULL, table);
@@ -1150,131 +1237,1296 @@ rb_grn_table_sort (int argc, VALUE *argv, VALUE self)
     return rb_result;
 }
 
-/*
- * call-seq:
- *   table.group([key1, key2, ...], options={}) -> [Groonga::Hash, ...]
- *   table.group(key, options={}) -> Groonga::Hash
- *
- * _table_ のレコードを _key1_ , _key2_ , _..._ で指定したキーの
- * 値でグループ化する。多くの場合、キーにはカラムを指定する。
- * カラムはカラム名（文字列）でも指定可能。
- */
-static VALUE
-rb_grn_table_group (int argc, VALUE *argv, VALUE self)
+typedef union _RbGrnTableTopKValue RbGrnTableTopKValue;
+union _RbGrnTableTopKValue
+{
+    int64_t int_value;
+    uint64_t uint_value;
+    double float_value;
+};
+
+typedef struct _RbGrnTableTopK RbGrnTableTopK;
+struct _RbGrnTableTopK
 {
-    grn_ctx *context = NULL;
-    grn_obj *table;
     grn_table_sort_key *keys;
-    grn_table_group_result *results;
-    int i, n_keys, n_results;
-    grn_rc rc;
-    VALUE rb_keys, rb_options;
-    VALUE *rb_group_keys;
-    VALUE rb_results;
+    grn_id *types;
+    int n_keys;
+    grn_id *ids;
+    RbGrnTableTopKValue *values;
+};
 
-    rb_grn_table_deconstruct(SELF(self), &table, &context,
-			     NULL, NULL,
-			     NULL, NULL, NULL,
-			     NULL);
+static grn_bool
+rb_grn_table_top_k_fixed_size_type_p (grn_id type_id)
+{
+    switch (type_id) {
+      case GRN_DB_INT32:
+      case GRN_DB_UINT32:
+      case GRN_DB_INT64:
+      case GRN_DB_UINT64:
+      case GRN_DB_FLOAT:
+      case GRN_DB_TIME:
+	return GRN_TRUE;
+      default:
+	return GRN_FALSE;
+    }
+}
 
-    rb_scan_args(argc, argv, "11", &rb_keys, &rb_options);
+static void
+rb_grn_table_top_k_read (grn_obj *bulk, RbGrnTableTopKValue *value,
+			 grn_id type_id)
+{
+    value->uint_value = 0;
+    if (GRN_BULK_VSIZE(bulk) == 0)
+	return;
 
-    if (TYPE(rb_keys) == T_ARRAY) {
-	n_keys = RARRAY_LEN(rb_keys);
-	rb_group_keys = RARRAY_PTR(rb_keys);
-    } else {
-	n_keys = 1;
-	rb_group_keys = &rb_keys;
+    switch (type_id) {
+      case GRN_DB_INT32:
+	value->int_value = GRN_INT32_VALUE(bulk);
+	break;
+      case GRN_DB_UINT32:
+	value->uint_value = GRN_UINT32_VALUE(bulk);
+	break;
+      case GRN_DB_INT64:
+	value->int_value = GRN_INT64_VALUE(bulk);
+	break;
+      case GRN_DB_UINT64:
+	value->uint_value = GRN_UINT64_VALUE(bulk);
+	break;
+      case GRN_DB_FLOAT:
+	value->float_value = GRN_FLOAT_VALUE(bulk);
+	break;
+      case GRN_DB_TIME:
+	value->int_value = GRN_TIME_VALUE(bulk);
+	break;
+      default:
+	break;
     }
+}
 
-    keys = ALLOCA_N(grn_table_sort_key, n_keys);
-    for (i = 0; i < n_keys; i++) {
-	VALUE rb_sort_options, rb_key;
-
-	if (RVAL2CBOOL(rb_obj_is_kind_of(rb_group_keys[i], rb_cHash))) {
-	    rb_sort_options = rb_group_keys[i];
-	} else {
-	    rb_sort_options = rb_hash_new();
-	    rb_hash_aset(rb_sort_options,
-			 RB_GRN_INTERN("key"),
-			 rb_group_keys[i]);
+/* Returns negative value if (a_id, a) should be ordered before
+   (b_id, b). Records that have the same values are ordered by ID. */
+static int
+rb_grn_table_top_k_compare (RbGrnTableTopK *top_k,
+			    grn_id a_id, RbGrnTableTopKValue *a,
+			    grn_id b_id, RbGrnTableTopKValue *b)
+{
+    int i;
+
+    for (i = 0; i < top_k->n_keys; i++) {
+	int compared = 0;
+
+	switch (top_k->types[i]) {
+	  case GRN_DB_UINT32:
+	  case GRN_DB_UINT64:
+	    if (a[i].uint_value != b[i].uint_value)
+		compared = a[i].uint_value < b[i].uint_value ? -1 : 1;
+	    break;
+	  case GRN_DB_FLOAT:
+	    if (a[i].float_value != b[i].float_value)
+		compared = a[i].float_value < b[i].float_value ? -1 : 1;
+	    break;
+	  default:
+	    if (a[i].int_value != b[i].int_value)
+		compared = a[i].int_value < b[i].int_value ? -1 : 1;
+	    break;
 	}
-	rb_grn_scan_options(rb_sort_options,
-			    "key", &rb_key,
-			    NULL);
-	if (RVAL2CBOOL(rb_obj_is_kind_of(rb_key, rb_cString))) {
-	    VALUE resolved_rb_key;
-	    resolved_rb_key = rb_grn_table_get_column(self, rb_key);
-	    if (NIL_P(resolved_rb_key)) {
-		rb_raise(rb_eArgError,
-			 "unknown group key: <%s>: <%s>",
-			 rb_grn_inspect(rb_key),
-			 rb_grn_inspect(self));
-	    }
-	    rb_key = resolved_rb_key;
+	if (compared != 0) {
+	    if (top_k->keys[i].flags & GRN_TABLE_SORT_DESC)
+		compared = -compared;
+	    return compared;
 	}
-	keys[i].key = RVAL2GRNOBJECT(rb_key, &context);
-	keys[i].flags = 0;
     }
 
-    n_results = n_keys;
-    results = ALLOCA_N(grn_table_group_result, n_results);
-    rb_results = rb_ary_new();
-    for (i = 0; i < n_results; i++) {
-	grn_obj *result;
-	grn_id range_id;
-	VALUE rb_result;
-
-	range_id = grn_obj_get_range(context, keys[i].key);
-	result = grn_table_create(context, NULL, 0, NULL,
-				  GRN_TABLE_HASH_KEY | GRN_OBJ_WITH_SUBREC,
-				  grn_ctx_at(context, range_id), 0);
-	results[i].table = result;
-	results[i].key_begin = 0;
-	results[i].key_end = 0;
-	results[i].limit = 0;
-	results[i].flags = 0;
-	results[i].op = GRN_OP_OR;
+    if (a_id == b_id)
+	return 0;
+    return a_id < b_id ? -1 : 1;
+}
 
-	rb_result = GRNOBJECT2RVAL(Qnil, context, result, GRN_TRUE);
-	rb_ary_push(rb_results, rb_result);
+static void
+rb_grn_table_top_k_swap (RbGrnTableTopK *top_k, int a, int b)
+{
+    grn_id id;
+    int i;
+
+    id = top_k->ids[a];
+    top_k->ids[a] = top_k->ids[b];
+    top_k->ids[b] = id;
+    for (i = 0; i < top_k->n_keys; i++) {
+	RbGrnTableTopKValue value;
+
+	value = top_k->values[a * top_k->n_keys + i];
+	top_k->values[a * top_k->n_keys + i] =
+	    top_k->values[b * top_k->n_keys + i];
+	top_k->values[b * top_k->n_keys + i] = value;
     }
+}
 
-    rc = grn_table_group(context, table, keys, n_keys, results, n_results);
-    rb_grn_context_check(context, self);
-    rb_grn_rc_check(rc, self);
+#define TOP_K_COMPARE(top_k, a, b)					\
+    rb_grn_table_top_k_compare((top_k),					\
+			       (top_k)->ids[(a)],			\
+			       (top_k)->values + (a) * (top_k)->n_keys,	\
+			       (top_k)->ids[(b)],			\
+			       (top_k)->values + (b) * (top_k)->n_keys)
 
-    if (n_results == 1)
-	return rb_ary_pop(rb_results);
-    else
-	return rb_results;
+/* Keeps the record that should be ordered at the last on the
+   root. */
+static void
+rb_grn_table_top_k_sift_down (RbGrnTableTopK *top_k, int i, int n)
+{
+    while (GRN_TRUE) {
+	int child, largest = i;
+
+	child = i * 2 + 1;
+	if (child < n && TOP_K_COMPARE(top_k, child, largest) > 0)
+	    largest = child;
+	child++;
+	if (child < n && TOP_K_COMPARE(top_k, child, largest) > 0)
+	    largest = child;
+	if (largest == i)
+	    break;
+	rb_grn_table_top_k_swap(top_k, i, largest);
+	i = largest;
+    }
 }
 
-/*
- * Document-method: []
- *
- * call-seq:
- *   table[id] -> Groonga::Record
- *
- * _table_ の _id_ に対応するGroonga::Recordを返す。
- *
- * 0.9.0から値ではなくGroonga::Recordを返すようになった。
- */
-VALUE
-rb_grn_table_array_reference (VALUE self, VALUE rb_id)
+static void
+rb_grn_table_top_k_sift_up (RbGrnTableTopK *top_k, int i)
 {
-    if (FIXNUM_P(rb_id)) {
-	return rb_grn_record_new_raw(self, rb_id, Qnil);
-    } else {
-	return Qnil;
+    while (i > 0) {
+	int parent = (i - 1) / 2;
+
+	if (TOP_K_COMPARE(top_k, i, parent) <= 0)
+	    break;
+	rb_grn_table_top_k_swap(top_k, i, parent);
+	i = parent;
     }
 }
 
-VALUE
-rb_grn_table_get_value (VALUE self, VALUE rb_id)
+#undef TOP_K_COMPARE
+
+static int
+rb_grn_table_top_k_collect (grn_ctx *context, grn_obj *table,
+			    RbGrnTableTopK *top_k, int k)
 {
+    grn_table_cursor *cursor;
+    grn_obj bulk;
     grn_id id;
-    grn_ctx *context;
+    RbGrnTableTopKValue *candidate;
+    int i, n = 0;
+
+    /* the slot after the heap is used as a buffer for a candidate. */
+    candidate = top_k->values + k * top_k->n_keys;
+    GRN_VOID_INIT(&bulk);
+    cursor = grn_table_cursor_open(context, table, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	for (i = 0; i < top_k->n_keys; i++) {
+	    GRN_BULK_REWIND(&bulk);
+	    grn_obj_get_value(context, top_k->keys[i].key, id, &bulk);
+	    rb_grn_table_top_k_read(&bulk, candidate + i, top_k->types[i]);
+	}
+
+	if (n < k) {
+	    top_k->ids[n] = id;
+	    memcpy(top_k->values + n * top_k->n_keys, candidate,
+		   sizeof(RbGrnTableTopKValue) * top_k->n_keys);
+	    rb_grn_table_top_k_sift_up(top_k, n);
+	    n++;
+	} else if (rb_grn_table_top_k_compare(top_k,
+					      id, candidate,
+					      top_k->ids[0],
+					      top_k->values) < 0) {
+	    top_k->ids[0] = id;
+	    memcpy(top_k->values, candidate,
+		   sizeof(RbGrnTableTopKValue) * top_k->n_keys);
+	    rb_grn_table_top_k_sift_down(top_k, 0, n);
+	}
+    }
+    grn_table_cursor_close(context, cursor);
+    GRN_OBJ_FIN(context, &bulk);
+
+    for (i = n - 1; i > 0; i--) {
+	rb_grn_table_top_k_swap(top_k, 0, i);
+	rb_grn_table_top_k_sift_down(top_k, 0, i);
+    }
+
+    return n;
+}
+
+static VALUE
+rb_grn_table_top_k_entry (grn_ctx *context, grn_table_sort_key *keys,
+			  int n_keys, grn_id id, grn_obj *bulk,
+			  VALUE related_object)
+{
+    VALUE rb_entry;
+    int i;
+
+    rb_entry = rb_ary_new2(n_keys + 1);
+    rb_ary_push(rb_entry, UINT2NUM(id));
+    for (i = 0; i < n_keys; i++) {
+	GRN_BULK_REWIND(bulk);
+	grn_obj_get_value(context, keys[i].key, id, bulk);
+	rb_ary_push(rb_entry,
+		    GRNBULK2RVAL(context, bulk, NULL, related_object));
+    }
+
+    return rb_entry;
+}
+
+typedef struct _RbGrnTableTopKData RbGrnTableTopKData;
+struct _RbGrnTableTopKData
+{
+    grn_ctx *context;
+    grn_obj *table;
+    RbGrnTableTopK top_k;
+    int k;
+    grn_bool fixed_size_p;
+    grn_obj bulk;
+    grn_obj *sorted;
+    grn_table_cursor *cursor;
+    VALUE self;
+    VALUE rb_result;
+};
+
+static VALUE
+rb_grn_table_top_k_body (VALUE user_data)
+{
+    RbGrnTableTopKData *data = (RbGrnTableTopKData *)user_data;
+    grn_ctx *context = data->context;
+    RbGrnTableTopK *top_k = &(data->top_k);
+    int i;
+
+    if (data->fixed_size_p) {
+	int n;
+
+	top_k->ids = ALLOC_N(grn_id, data->k);
+	top_k->values = ALLOC_N(RbGrnTableTopKValue,
+				(data->k + 1) * top_k->n_keys);
+	n = rb_grn_table_top_k_collect(context, data->table, top_k, data->k);
+	for (i = 0; i < n; i++) {
+	    rb_ary_push(data->rb_result,
+			rb_grn_table_top_k_entry(context,
+						 top_k->keys, top_k->n_keys,
+						 top_k->ids[i], &(data->bulk),
+						 data->self));
+	}
+    } else {
+	grn_table_sort_key *keys;
+
+	/* sort by ID at the last to order records that have the
+	   same values as the same as the fixed size case. */
+	keys = ALLOCA_N(grn_table_sort_key, top_k->n_keys + 1);
+	MEMCPY(keys, top_k->keys, grn_table_sort_key, top_k->n_keys);
+	keys[top_k->n_keys].key = grn_obj_column(context, data->table,
+						 "_id", strlen("_id"));
+	keys[top_k->n_keys].flags = GRN_TABLE_SORT_ASC;
+	data->sorted = grn_table_create(context, NULL, 0, NULL,
+					GRN_TABLE_NO_KEY,
+					NULL, data->table);
+	grn_table_sort(context, data->table, 0, data->k, data->sorted,
+		       keys, top_k->n_keys + 1);
+	grn_obj_unlink(context, keys[top_k->n_keys].key);
+	data->cursor = grn_table_cursor_open(context, data->sorted,
+					     NULL, 0, NULL, 0,
+					     0, -1, GRN_CURSOR_ASCENDING);
+	while (grn_table_cursor_next(context, data->cursor) != GRN_ID_NIL) {
+	    void *value;
+	    grn_id *id;
+
+	    grn_table_cursor_get_value(context, data->cursor, &value);
+	    id = value;
+	    rb_ary_push(data->rb_result,
+			rb_grn_table_top_k_entry(context,
+						 top_k->keys, top_k->n_keys,
+						 *id, &(data->bulk),
+						 data->self));
+	}
+    }
+    rb_grn_context_check(context, data->self);
+
+    return data->rb_result;
+}
+
+static VALUE
+rb_grn_table_top_k_ensure (VALUE user_data)
+{
+    RbGrnTableTopKData *data = (RbGrnTableTopKData *)user_data;
+    grn_ctx *context = data->context;
+
+    if (data->top_k.ids)
+	xfree(data->top_k.ids);
+    if (data->top_k.values)
+	xfree(data->top_k.values);
+    if (data->cursor)
+	grn_table_cursor_close(context, data->cursor);
+    if (data->sorted)
+	grn_obj_unlink(context, data->sorted);
+    GRN_OBJ_FIN(context, &(data->bulk));
+
+    return Qnil;
+}
+
+/*
+ * call-seq:
+ *   table.top_k(keys, k) -> [[id, value1, ...], ...]
+ *
+ * テーブルのレコードを _keys_ でソートしたときの先頭 _k_ 件
+ * のレコードIDとソートキーの値を返す。 _keys_ の指定方法は
+ * #sort と同じ。
+ *
+ * #sort と違ってGroonga::Recordを作らず、ソート済みの一時テー
+ * ブルも作らない。大きな検索結果から上位の少数のレコードだけ
+ * が欲しい場合に速い。
+ *
+ * ソートキーが全て数値またはTimeのカラム（ +_score+ などを
+ * 含む）の場合は _k_ 件分の領域だけを使ってテーブルを1回走
+ * 査する。それ以外のソートキーが含まれる場合は _:limit_ に
+ * _k_ を指定した #sort と同じ方法でソートする。どちらの場合
+ * も同じ値のレコードはIDの昇順に並ぶ。
+ *
+ * @example
+ *   results = entries.select {|record| record.content =~ "groonga"}
+ *   results.top_k([["_score", :desc]], 20).each do |id, score|
+ *     puts "#{id}: #{score}"
+ *   end
+ */
+static VALUE
+rb_grn_table_top_k (VALUE self, VALUE rb_keys, VALUE rb_k)
+{
+    grn_ctx *context = NULL;
+    grn_obj *table;
+    grn_table_sort_key *keys;
+    grn_id *types;
+    int i, k, n_keys;
+    RbGrnTableTopKData data;
+
+    rb_grn_table_deconstruct(SELF(self), &table, &context,
+			     NULL, NULL,
+			     NULL, NULL, NULL,
+			     NULL);
+
+    if (!RVAL2CBOOL(rb_obj_is_kind_of(rb_keys, rb_cArray)))
+	rb_raise(rb_eArgError, "keys should be an array of key: <%s>",
+		 rb_grn_inspect(rb_keys));
+
+    k = NUM2INT(rb_k);
+    if (k < 0)
+	rb_raise(rb_eArgError, "k should be 0 or larger: <%d>", k);
+    /* k may be much larger than the table such as INT_MAX to get
+       all records. Don't allocate more than the table has. */
+    if ((unsigned int)k > grn_table_size(context, table))
+	k = grn_table_size(context, table);
+
+    n_keys = RARRAY_LEN(rb_keys);
+    keys = ALLOCA_N(grn_table_sort_key, n_keys);
+    rb_grn_table_sort_keys_fill(self, context, keys, n_keys,
+				RARRAY_PTR(rb_keys));
+    types = ALLOCA_N(grn_id, n_keys);
+    data.fixed_size_p = GRN_TRUE;
+    for (i = 0; i < n_keys; i++) {
+	types[i] = grn_obj_get_range(context, keys[i].key);
+	if (!rb_grn_table_top_k_fixed_size_type_p(types[i]))
+	    data.fixed_size_p = GRN_FALSE;
+    }
+
+    data.rb_result = rb_ary_new2(k);
+    if (k == 0)
+	return data.rb_result;
+
+    data.context = context;
+    data.table = table;
+    data.top_k.keys = keys;
+    data.top_k.types = types;
+    data.top_k.n_keys = n_keys;
+    data.top_k.ids = NULL;
+    data.top_k.values = NULL;
+    data.k = k;
+    data.sorted = NULL;
+    data.cursor = NULL;
+    data.self = self;
+    GRN_VOID_INIT(&(data.bulk));
+
+    return rb_ensure(rb_grn_table_top_k_body, (VALUE)&data,
+		     rb_grn_table_top_k_ensure, (VALUE)&data);
+}
+
+typedef struct _RbGrnTableSortRun RbGrnTableSortRun;
+struct _RbGrnTableSortRun
+{
+    RbGrnTableTopK *data;
+    unsigned int *source;
+    unsigned int *destination;
+    unsigned int start;
+    unsigned int middle;
+    unsigned int end;
+};
+
+static void
+rb_grn_table_sort_merge (RbGrnTableTopK *data,
+			 unsigned int *source, unsigned int *destination,
+			 unsigned int start, unsigned int middle,
+			 unsigned int end)
+{
+    unsigned int i = start, j = middle, k = start;
+    int n_keys = data->n_keys;
+
+    while (i < middle && j < end) {
+	if (rb_grn_table_top_k_compare(data,
+				       data->ids[source[j]],
+				       data->values + source[j] * n_keys,
+				       data->ids[source[i]],
+				       data->values + source[i] * n_keys) < 0) {
+	    destination[k++] = source[j++];
+	} else {
+	    destination[k++] = source[i++];
+	}
+    }
+    while (i < middle)
+	destination[k++] = source[i++];
+    while (j < end)
+	destination[k++] = source[j++];
+}
+
+static void *
+rb_grn_table_sort_run_sort (void *data)
+{
+    RbGrnTableSortRun *run = data;
+    unsigned int *source, *destination, *temporary;
+    unsigned int width, n;
+
+    source = run->source;
+    destination = run->destination;
+    n = run->end - run->start;
+    for (width = 1; width < n; width *= 2) {
+	unsigned int start;
+
+	for (start = run->start; start < run->end; start += width * 2) {
+	    unsigned int middle, end;
+
+	    middle = start + width;
+	    if (middle > run->end)
+		middle = run->end;
+	    end = middle + width;
+	    if (end > run->end)
+		end = run->end;
+	    rb_grn_table_sort_merge(run->data, source, destination,
+				    start, middle, end);
+	}
+	temporary = source;
+	source = destination;
+	destination = temporary;
+    }
+    if (source != run->source)
+	memcpy(run->source + run->start, source + run->start,
+	       sizeof(unsigned int) * n);
+
+    return NULL;
+}
+
+static void *
+rb_grn_table_sort_run_merge (void *data)
+{
+    RbGrnTableSortRun *run = data;
+
+    rb_grn_table_sort_merge(run->data, run->source, run->destination,
+			    run->start, run->middle, run->end);
+
+    return NULL;
+}
+
+static VALUE
+rb_grn_table_sort_parallel (grn_ctx *context, grn_obj *table,
+			    grn_table_sort_key *keys, grn_id *types,
+			    int n_keys, int offset, int limit,
+			    int n_workers, VALUE self)
+{
+    RbGrnTableTopK data;
+    RbGrnTableSortRun *runs;
+    grn_table_cursor *cursor;
+    grn_obj bulk;
+    grn_id id;
+    unsigned int i, n_records, size;
+    unsigned int *order, *buffer, *sorted;
+    int j, n_runs;
+    VALUE rb_result;
+
+    size = grn_table_size(context, table);
+    data.keys = keys;
+    data.types = types;
+    data.n_keys = n_keys;
+    data.ids = ALLOC_N(grn_id, size);
+    data.values = ALLOC_N(RbGrnTableTopKValue, size * n_keys);
+
+    n_records = 0;
+    GRN_VOID_INIT(&bulk);
+    cursor = grn_table_cursor_open(context, table, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while (n_records < size &&
+	   (id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	data.ids[n_records] = id;
+	for (j = 0; j < n_keys; j++) {
+	    GRN_BULK_REWIND(&bulk);
+	    grn_obj_get_value(context, keys[j].key, id, &bulk);
+	    rb_grn_table_top_k_read(&bulk,
+				    data.values + n_records * n_keys + j,
+				    types[j]);
+	}
+	n_records++;
+    }
+    grn_table_cursor_close(context, cursor);
+
+    order = ALLOC_N(unsigned int, n_records);
+    buffer = ALLOC_N(unsigned int, n_records);
+    for (i = 0; i < n_records; i++) {
+	order[i] = i;
+    }
+
+    if ((unsigned int)n_workers > n_records)
+	n_workers = n_records > 0 ? n_records : 1;
+    runs = ALLOC_N(RbGrnTableSortRun, n_workers);
+    for (j = 0; j < n_workers; j++) {
+	runs[j].data = &data;
+	runs[j].source = order;
+	runs[j].destination = buffer;
+	runs[j].start = (unsigned int)(((uint64_t)n_records * j) / n_workers);
+	runs[j].end =
+	    (unsigned int)(((uint64_t)n_records * (j + 1)) / n_workers);
+	runs[j].middle = runs[j].end;
+    }
+    rb_grn_run_workers(rb_grn_table_sort_run_sort,
+		       runs, sizeof(RbGrnTableSortRun), n_workers);
+
+    sorted = order;
+    for (n_runs = n_workers; n_runs > 1; n_runs = (n_runs + 1) / 2) {
+	unsigned int *destination;
+	int n_merges = (n_runs + 1) / 2;
+
+	destination = sorted == order ? buffer : order;
+	for (j = 0; j < n_merges; j++) {
+	    RbGrnTableSortRun *left = &(runs[j * 2]);
+
+	    left->source = sorted;
+	    left->destination = destination;
+	    if (j * 2 + 1 < n_runs) {
+		left->middle = left->end;
+		left->end = runs[j * 2 + 1].end;
+	    } else {
+		left->middle = left->end;
+	    }
+	    runs[j] = *left;
+	}
+	rb_grn_run_workers(rb_grn_table_sort_run_merge,
+			   runs, sizeof(RbGrnTableSortRun), n_merges);
+	sorted = destination;
+    }
+
+    if (offset > (int)n_records)
+	offset = n_records;
+    if (limit < 0 || offset + limit > (int)n_records)
+	limit = n_records - offset;
+    rb_result = rb_ary_new2(limit);
+    for (i = offset; i < (unsigned int)(offset + limit); i++) {
+	rb_ary_push(rb_result,
+		    rb_grn_record_new(self, data.ids[sorted[i]], Qnil));
+    }
+
+    GRN_OBJ_FIN(context, &bulk);
+    xfree(runs);
+    xfree(order);
+    xfree(buffer);
+    xfree(data.ids);
+    xfree(data.values);
+
+    return rb_result;
+}
+
+typedef struct _RbGrnTableGroupStatistics RbGrnTableGroupStatistics;
+struct _RbGrnTableGroupStatistics
+{
+    double sum;
+    double min;
+    double max;
+    int64_t integer_sum;
+    int64_t integer_min;
+    int64_t integer_max;
+    unsigned int n_values;
+};
+
+typedef struct _RbGrnTableGroupAggregate RbGrnTableGroupAggregate;
+struct _RbGrnTableGroupAggregate
+{
+    VALUE rb_name;
+    VALUE rb_operators;
+    grn_obj *column;
+    grn_bool integer_p;
+};
+
+static grn_bool
+rb_grn_table_group_numeric_type_p (grn_id type_id)
+{
+    switch (type_id) {
+      case GRN_DB_INT32:
+      case GRN_DB_UINT32:
+      case GRN_DB_INT64:
+      case GRN_DB_UINT64:
+      case GRN_DB_FLOAT:
+      case GRN_DB_TIME:
+	return GRN_TRUE;
+      default:
+	return GRN_FALSE;
+    }
+}
+
+static grn_bool
+rb_grn_table_group_integer_type_p (grn_id type_id)
+{
+    switch (type_id) {
+      case GRN_DB_INT32:
+      case GRN_DB_UINT32:
+      case GRN_DB_INT64:
+      case GRN_DB_UINT64:
+	return GRN_TRUE;
+      default:
+	return GRN_FALSE;
+    }
+}
+
+static int64_t
+rb_grn_table_group_value_to_int64 (grn_obj *value)
+{
+    switch (value->header.domain) {
+      case GRN_DB_INT32:
+	return GRN_INT32_VALUE(value);
+      case GRN_DB_UINT32:
+	return GRN_UINT32_VALUE(value);
+      case GRN_DB_INT64:
+	return GRN_INT64_VALUE(value);
+      case GRN_DB_UINT64:
+	return (int64_t)GRN_UINT64_VALUE(value);
+      default:
+	return 0;
+    }
+}
+
+static double
+rb_grn_table_group_value_to_double (grn_obj *value)
+{
+    switch (value->header.domain) {
+      case GRN_DB_INT32:
+	return GRN_INT32_VALUE(value);
+      case GRN_DB_UINT32:
+	return GRN_UINT32_VALUE(value);
+      case GRN_DB_INT64:
+	return GRN_INT64_VALUE(value);
+      case GRN_DB_UINT64:
+	return GRN_UINT64_VALUE(value);
+      case GRN_DB_FLOAT:
+	return GRN_FLOAT_VALUE(value);
+      case GRN_DB_TIME:
+	return GRN_TIME_VALUE(value) / (double)GRN_TIME_USEC_PER_SEC;
+      default:
+	return 0.0;
+    }
+}
+
+static void
+rb_grn_table_group_limit (grn_ctx *context, grn_obj *result,
+			  const char *sort_by, unsigned int sort_by_size,
+			  int sort_flags, int limit, VALUE related_object)
+{
+    grn_table_sort_key sort_key;
+    grn_obj *sorted;
+    grn_table_cursor *cursor;
+    unsigned int size;
+    char *kept;
+    grn_id id;
+
+    size = grn_table_size(context, result);
+    if (size <= (unsigned int)limit)
+	return;
+
+    sort_key.key = grn_obj_column(context, result, sort_by, sort_by_size);
+    if (!sort_key.key)
+	rb_raise(rb_eArgError,
+		 "unknown sort key: <%.*s>: <%s>",
+		 sort_by_size, sort_by, rb_grn_inspect(related_object));
+    sort_key.flags = sort_flags;
+    sorted = grn_table_create(context, NULL, 0, NULL, GRN_TABLE_NO_KEY,
+			      NULL, result);
+    grn_table_sort(context, result, 0, limit, sorted, &sort_key, 1);
+    grn_obj_unlink(context, sort_key.key);
+
+    kept = ALLOC_N(char, size + 1);
+    MEMZERO(kept, char, size + 1);
+    cursor = grn_table_cursor_open(context, sorted, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while (grn_table_cursor_next(context, cursor) != GRN_ID_NIL) {
+	void *value;
+	grn_id *sorted_id;
+
+	grn_table_cursor_get_value(context, cursor, &value);
+	sorted_id = value;
+	if (*sorted_id <= size)
+	    kept[*sorted_id] = 1;
+    }
+    grn_table_cursor_close(context, cursor);
+    grn_obj_unlink(context, sorted);
+
+    cursor = grn_table_cursor_open(context, result, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	if (id > size || !kept[id])
+	    grn_table_cursor_delete(context, cursor);
+    }
+    grn_table_cursor_close(context, cursor);
+    xfree(kept);
+
+    rb_grn_context_check(context, related_object);
+}
+
+static VALUE
+rb_grn_table_group_aggregates_to_ruby_object (grn_ctx *context,
+					      grn_obj *result,
+					      RbGrnTableGroupAggregate *aggregates,
+					      int n_aggregates,
+					      RbGrnTableGroupStatistics **statistics)
+{
+    VALUE rb_aggregates;
+    grn_table_cursor *cursor;
+    grn_id id;
+    int i, j;
+
+    rb_aggregates = rb_hash_new();
+    cursor = grn_table_cursor_open(context, result, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	VALUE rb_group;
+
+	rb_group = rb_hash_new();
+	for (i = 0; i < n_aggregates; i++) {
+	    RbGrnTableGroupStatistics *statistic;
+	    VALUE rb_values;
+
+	    statistic = &(statistics[i][id]);
+	    rb_values = rb_hash_new();
+	    for (j = 0; j < RARRAY_LEN(aggregates[i].rb_operators); j++) {
+		VALUE rb_operator, rb_value = Qnil;
+
+		rb_operator = RARRAY_PTR(aggregates[i].rb_operators)[j];
+		if (rb_grn_equal_option(rb_operator, "sum")) {
+		    if (aggregates[i].integer_p)
+			rb_value = LL2NUM(statistic->integer_sum);
+		    else
+			rb_value = rb_float_new(statistic->sum);
+		} else if (statistic->n_values == 0) {
+		    rb_value = Qnil;
+		} else if (rb_grn_equal_option(rb_operator, "min")) {
+		    if (aggregates[i].integer_p)
+			rb_value = LL2NUM(statistic->integer_min);
+		    else
+			rb_value = rb_float_new(statistic->min);
+		} else if (rb_grn_equal_option(rb_operator, "max")) {
+		    if (aggregates[i].integer_p)
+			rb_value = LL2NUM(statistic->integer_max);
+		    else
+			rb_value = rb_float_new(statistic->max);
+		} else if (aggregates[i].integer_p) {
+		    rb_value = rb_float_new((double)statistic->integer_sum /
+					    statistic->n_values);
+		} else {
+		    rb_value = rb_float_new(statistic->sum /
+					    statistic->n_values);
+		}
+		rb_hash_aset(rb_values, rb_operator, rb_value);
+	    }
+	    rb_hash_aset(rb_group, aggregates[i].rb_name, rb_values);
+	}
+	rb_hash_aset(rb_aggregates, UINT2NUM(id), rb_group);
+    }
+    grn_table_cursor_close(context, cursor);
+
+    return rb_aggregates;
+}
+
+typedef struct _RbGrnTableGroupAggregateData RbGrnTableGroupAggregateData;
+struct _RbGrnTableGroupAggregateData
+{
+    grn_ctx *context;
+    grn_obj *table;
+    grn_table_sort_key *keys;
+    int n_keys;
+    grn_table_group_result *results;
+    RbGrnTableGroupAggregate *aggregates;
+    int n_aggregates;
+    RbGrnTableGroupStatistics **statistics;
+    int n_statistics;
+};
+
+static VALUE
+rb_grn_table_group_aggregate_body (VALUE user_data)
+{
+    RbGrnTableGroupAggregateData *data;
+    grn_ctx *context;
+    RbGrnTableGroupStatistics **statistics;
+    grn_table_cursor *cursor;
+    grn_obj key_value, value;
+    grn_id id, *max_ids;
+    int i, j, n_keys, n_aggregates;
+    VALUE rb_aggregates;
+
+    data = (RbGrnTableGroupAggregateData *)user_data;
+    context = data->context;
+    statistics = data->statistics;
+    n_keys = data->n_keys;
+    n_aggregates = data->n_aggregates;
+
+    max_ids = ALLOCA_N(grn_id, n_keys);
+    for (i = 0; i < n_keys; i++) {
+	/* IDs may be sparse when groups are removed by :limit. */
+	max_ids[i] = GRN_ID_NIL;
+	cursor = grn_table_cursor_open(context, data->results[i].table,
+				       NULL, 0, NULL, 0,
+				       0, -1, GRN_CURSOR_ASCENDING);
+	while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	    if (id > max_ids[i])
+		max_ids[i] = id;
+	}
+	grn_table_cursor_close(context, cursor);
+
+	for (j = 0; j < n_aggregates; j++) {
+	    RbGrnTableGroupStatistics *statistic;
+
+	    statistic = ALLOC_N(RbGrnTableGroupStatistics, max_ids[i] + 1);
+	    MEMZERO(statistic, RbGrnTableGroupStatistics, max_ids[i] + 1);
+	    statistics[i * n_aggregates + j] = statistic;
+	}
+    }
+
+    GRN_VOID_INIT(&key_value);
+    GRN_VOID_INIT(&value);
+    cursor = grn_table_cursor_open(context, data->table, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	for (i = 0; i < n_keys; i++) {
+	    grn_id group_id;
+
+	    GRN_BULK_REWIND(&key_value);
+	    grn_obj_get_value(context, data->keys[i].key, id, &key_value);
+	    group_id = grn_table_get(context, data->results[i].table,
+				     GRN_BULK_HEAD(&key_value),
+				     GRN_BULK_VSIZE(&key_value));
+	    if (group_id == GRN_ID_NIL || group_id > max_ids[i])
+		continue;
+
+	    for (j = 0; j < n_aggregates; j++) {
+		RbGrnTableGroupStatistics *statistic;
+		double number;
+
+		GRN_BULK_REWIND(&value);
+		grn_obj_get_value(context, data->aggregates[j].column, id,
+				  &value);
+		if (GRN_BULK_VSIZE(&value) == 0)
+		    continue;
+
+		statistic = &(statistics[i * n_aggregates + j][group_id]);
+		if (data->aggregates[j].integer_p) {
+		    int64_t integer;
+
+		    integer = rb_grn_table_group_value_to_int64(&value);
+		    if (statistic->n_values == 0) {
+			statistic->integer_min = integer;
+			statistic->integer_max = integer;
+		    } else {
+			if (integer < statistic->integer_min)
+			    statistic->integer_min = integer;
+			if (integer > statistic->integer_max)
+			    statistic->integer_max = integer;
+		    }
+		    statistic->integer_sum += integer;
+		    statistic->n_values++;
+		    continue;
+		}
+		number = rb_grn_table_group_value_to_double(&value);
+		if (statistic->n_values == 0) {
+		    statistic->min = number;
+		    statistic->max = number;
+		} else {
+		    if (number < statistic->min)
+			statistic->min = number;
+		    if (number > statistic->max)
+			statistic->max = number;
+		}
+		statistic->sum += number;
+		statistic->n_values++;
+	    }
+	}
+    }
+    grn_table_cursor_close(context, cursor);
+    GRN_OBJ_FIN(context, &key_value);
+    GRN_OBJ_FIN(context, &value);
+
+    rb_aggregates = rb_ary_new();
+    for (i = 0; i < n_keys; i++) {
+	rb_ary_push(rb_aggregates,
+		    rb_grn_table_group_aggregates_to_ruby_object(
+			context, data->results[i].table,
+			data->aggregates, n_aggregates,
+			statistics + i * n_aggregates));
+    }
+
+    return rb_aggregates;
+}
+
+static VALUE
+rb_grn_table_group_aggregate_ensure (VALUE user_data)
+{
+    RbGrnTableGroupAggregateData *data;
+    int i;
+
+    data = (RbGrnTableGroupAggregateData *)user_data;
+    for (i = 0; i < data->n_statistics; i++) {
+	if (data->statistics[i])
+	    xfree(data->statistics[i]);
+    }
+    xfree(data->statistics);
+
+    return Qnil;
+}
+
+static VALUE
+rb_grn_table_group_aggregate (grn_ctx *context, grn_obj *table,
+			      grn_table_sort_key *keys, int n_keys,
+			      grn_table_group_result *results,
+			      RbGrnTableGroupAggregate *aggregates,
+			      int n_aggregates)
+{
+    RbGrnTableGroupAggregateData data;
+
+    data.context = context;
+    data.table = table;
+    data.keys = keys;
+    data.n_keys = n_keys;
+    data.results = results;
+    data.aggregates = aggregates;
+    data.n_aggregates = n_aggregates;
+    data.n_statistics = n_keys * n_aggregates;
+    data.statistics = ALLOC_N(RbGrnTableGroupStatistics *,
+			      data.n_statistics);
+    MEMZERO(data.statistics, RbGrnTableGroupStatistics *,
+	    data.n_statistics);
+
+    return rb_ensure(rb_grn_table_group_aggregate_body, (VALUE)&data,
+		     rb_grn_table_group_aggregate_ensure, (VALUE)&data);
+}
+
+/*
+ * call-seq:
+ *   table.group([key1, key2, ...], options={}) -> [Groonga::Hash, ...]
+ *   table.group(key, options={}) -> Groonga::Hash
+ *
+ * _table_ のレコードを _key1_ , _key2_ , _..._ で指定したキーの
+ * 値でグループ化する。多くの場合、キーにはカラムを指定する。
+ * カラムはカラム名（文字列）でも指定可能。
+ *
+ * 複数のキーを指定した場合はキーごとに独立にグループ化した
+ * 結果を配列で返す。 _table_ の走査は1回だけで済む。
+ *
+ * _options_ に指定可能な値は以下の通り。
+ * @param options [::Hash] The name and value
+ *   pairs. Omitted names are initialized as the default value.
+ * @option options :limit The limit
+ *
+ *   +:sort_by+ の順に並べたときの上位 _:limit_ 件のグループだ
+ *   けを結果に残す。省略した場合は全てのグループを残す。
+ *
+ * @option options :sort_by ("_nsubrecs") The sort_by
+ *
+ *   +:limit+ で残すグループを決めるときのソートキー。グループ
+ *   化した結果のテーブルのカラム名を指定する。
+ *
+ * @option options :order (:desc) The order
+ *
+ *   +:sort_by+ の順序。 +:asc+ , +:ascending+ , +:desc+ ,
+ *   +:descending+ のいずれかを指定する。
+ *
+ * @option options :aggregate The aggregate
+ *
+ *   グループごとに集計するカラムと集計方法のHash。集計方法は
+ *   +:sum+ , +:min+ , +:max+ , +:average+ の配列で指定する。
+ *   数値またはTimeのカラムのみ指定できる。ベクターカラムを
+ *   キーにした場合は集計できないのでArgumentErrorになる。
+ *
+ *   集計結果は返したテーブルの +aggregates+ で取得できる。
+ *   +aggregates+ はグループのレコードIDをキーにした以下のよ
+ *   うなHash。整数のカラムの +:sum+ , +:min+ , +:max+ は
+ *   Integer、それ以外の値はFloat。
+ *   <pre>
+ *   =={
+ *     group_record_id => {
+ *       "price" => {:sum => 3000, :max => 1200},
+ *     },
+ *     ...,
+ *   }==
+ *   </pre>
+ *
+ * @example
+ *   categories = items.group("category",
+ *                            :limit => 10,
+ *                            :aggregate => {"price" => [:sum, :max]})
+ *   categories.each do |category|
+ *     price = categories.aggregates[category.id]["price"]
+ *     puts "#{category.key}: #{category.n_sub_records}: #{price[:sum]}"
+ *   end
+ */
+static VALUE
+rb_grn_table_group (int argc, VALUE *argv, VALUE self)
+{
+    grn_ctx *context = NULL;
+    grn_obj *table;
+    grn_table_sort_key *keys;
+    grn_table_group_result *results;
+    RbGrnTableGroupAggregate *aggregates = NULL;
+    int i, n_keys, n_results, n_aggregates = 0;
+    int limit = 0;
+    int sort_flags = GRN_TABLE_SORT_DESC;
+    const char *sort_by = "_nsubrecs";
+    unsigned int sort_by_size = strlen("_nsubrecs");
+    grn_rc rc;
+    VALUE rb_keys, rb_options;
+    VALUE rb_limit, rb_sort_by, rb_order, rb_aggregate;
+    VALUE *rb_group_keys;
+    VALUE rb_results;
+
+    rb_grn_table_deconstruct(SELF(self), &table, &context,
+			     NULL, NULL,
+			     NULL, NULL, NULL,
+			     NULL);
+
+    rb_scan_args(argc, argv, "11", &rb_keys, &rb_options);
+
+    rb_grn_scan_options(rb_options,
+			"limit", &rb_limit,
+			"sort_by", &rb_sort_by,
+			"order", &rb_order,
+			"aggregate", &rb_aggregate,
+			NULL);
+
+    if (!NIL_P(rb_limit)) {
+	limit = NUM2INT(rb_limit);
+	if (limit < 0)
+	    rb_raise(rb_eArgError,
+		     "limit should not be negative: <%d>: <%s>",
+		     limit, rb_grn_inspect(self));
+    }
+    if (!NIL_P(rb_sort_by)) {
+	if (SYMBOL_P(rb_sort_by))
+	    rb_sort_by = rb_sym_to_s(rb_sort_by);
+	sort_by = StringValuePtr(rb_sort_by);
+	sort_by_size = RSTRING_LEN(rb_sort_by);
+    }
+    if (NIL_P(rb_order) ||
+	rb_grn_equal_option(rb_order, "desc") ||
+	rb_grn_equal_option(rb_order, "descending")) {
+	sort_flags = GRN_TABLE_SORT_DESC;
+    } else if (rb_grn_equal_option(rb_order, "asc") ||
+	       rb_grn_equal_option(rb_order, "ascending")) {
+	sort_flags = GRN_TABLE_SORT_ASC;
+    } else {
+	rb_raise(rb_eArgError,
+		 "order should be one of "
+		 "[nil, :desc, :descending, :asc, :ascending]: %s",
+		 rb_grn_inspect(rb_order));
+    }
+
+    if (TYPE(rb_keys) == T_ARRAY) {
+	n_keys = RARRAY_LEN(rb_keys);
+	rb_group_keys = RARRAY_PTR(rb_keys);
+    } else {
+	n_keys = 1;
+	rb_group_keys = &rb_keys;
+    }
+
+    keys = ALLOCA_N(grn_table_sort_key, n_keys);
+    for (i = 0; i < n_keys; i++) {
+	VALUE rb_sort_options, rb_key;
+
+	if (RVAL2CBOOL(rb_obj_is_kind_of(rb_group_keys[i], rb_cHash))) {
+	    rb_sort_options = rb_group_keys[i];
+	} else {
+	    rb_sort_options = rb_hash_new();
+	    rb_hash_aset(rb_sort_options,
+			 RB_GRN_INTERN("key"),
+			 rb_group_keys[i]);
+	}
+	rb_grn_scan_options(rb_sort_options,
+			    "key", &rb_key,
+			    NULL);
+	if (RVAL2CBOOL(rb_obj_is_kind_of(rb_key, rb_cString))) {
+	    VALUE resolved_rb_key;
+	    resolved_rb_key = rb_grn_table_get_column(self, rb_key);
+	    if (NIL_P(resolved_rb_key)) {
+		rb_raise(rb_eArgError,
+			 "unknown group key: <%s>: <%s>",
+			 rb_grn_inspect(rb_key),
+			 rb_grn_inspect(self));
+	    }
+	    rb_key = resolved_rb_key;
+	}
+	keys[i].key = RVAL2GRNOBJECT(rb_key, &context);
+	keys[i].flags = 0;
+    }
+
+    if (!NIL_P(rb_aggregate)) {
+	VALUE rb_aggregate_names;
+
+	rb_aggregate = rb_convert_type(rb_aggregate, T_HASH, "Hash", "to_hash");
+	rb_aggregate_names = rb_funcall(rb_aggregate, rb_intern("keys"), 0);
+	n_aggregates = RARRAY_LEN(rb_aggregate_names);
+	aggregates = ALLOCA_N(RbGrnTableGroupAggregate, n_aggregates);
+	for (i = 0; i < n_aggregates; i++) {
+	    VALUE rb_name, rb_column, rb_operators;
+	    int j;
+
+	    rb_name = RARRAY_PTR(rb_aggregate_names)[i];
+	    rb_operators = rb_hash_aref(rb_aggregate, rb_name);
+	    if (!RVAL2CBOOL(rb_obj_is_kind_of(rb_operators, rb_cArray)))
+		rb_operators = rb_ary_new3(1, rb_operators);
+	    for (j = 0; j < RARRAY_LEN(rb_operators); j++) {
+		VALUE rb_operator = RARRAY_PTR(rb_operators)[j];
+		if (!(rb_grn_equal_option(rb_operator, "sum") ||
+		      rb_grn_equal_option(rb_operator, "min") ||
+		      rb_grn_equal_option(rb_operator, "max") ||
+		      rb_grn_equal_option(rb_operator, "average"))) {
+		    rb_raise(rb_eArgError,
+			     "aggregate operator should be one of "
+			     "[:sum, :min, :max, :average]: %s",
+			     rb_grn_inspect(rb_operator));
+		}
+	    }
+	    if (RVAL2CBOOL(rb_obj_is_kind_of(rb_name, rb_cGrnObject))) {
+		rb_column = rb_name;
+	    } else {
+		rb_column = rb_grn_table_get_column(self, rb_name);
+		if (NIL_P(rb_column)) {
+		    rb_raise(rb_eArgError,
+			     "unknown aggregate column: <%s>: <%s>",
+			     rb_grn_inspect(rb_name),
+			     rb_grn_inspect(self));
+		}
+	    }
+	    aggregates[i].rb_name = rb_name;
+	    aggregates[i].rb_operators = rb_operators;
+	    aggregates[i].column = RVAL2GRNOBJECT(rb_column, &context);
+	    if (!rb_grn_table_group_numeric_type_p(
+		    grn_obj_get_range(context, aggregates[i].column))) {
+		rb_raise(rb_eArgError,
+			 "aggregate column should be numeric or Time: "
+			 "<%s>: <%s>",
+			 rb_grn_inspect(rb_name),
+			 rb_grn_inspect(self));
+	    }
+	    aggregates[i].integer_p = rb_grn_table_group_integer_type_p(
+		grn_obj_get_range(context, aggregates[i].column));
+	}
+
+	for (i = 0; i < n_keys; i++) {
+	    if (keys[i].key->header.type == GRN_COLUMN_VAR_SIZE &&
+		((keys[i].key->header.flags & GRN_OBJ_COLUMN_TYPE_MASK) ==
+		 GRN_OBJ_COLUMN_VECTOR)) {
+		rb_raise(rb_eArgError,
+			 "can't aggregate by vector column group key: "
+			 "<%s>: <%s>",
+			 rb_grn_inspect(rb_group_keys[i]),
+			 rb_grn_inspect(self));
+	    }
+	}
+    }
+
+    n_results = n_keys;
+    results = ALLOCA_N(grn_table_group_result, n_results);
+    rb_results = rb_ary_new();
+    for (i = 0; i < n_results; i++) {
+	grn_obj *result;
+	grn_id range_id;
+	VALUE rb_result;
+
+	range_id = grn_obj_get_range(context, keys[i].key);
+	result = grn_table_create(context, NULL, 0, NULL,
+				  GRN_TABLE_HASH_KEY | GRN_OBJ_WITH_SUBREC,
+				  grn_ctx_at(context, range_id), 0);
+	results[i].table = result;
+	results[i].key_begin = i;
+	results[i].key_end = i + 1;
+	results[i].limit = 0;
+	results[i].flags = 0;
+	results[i].op = GRN_OP_OR;
+
+	rb_result = GRNOBJECT2RVAL(Qnil, context, result, GRN_TRUE);
+	rb_ary_push(rb_results, rb_result);
+    }
+
+    rc = grn_table_group(context, table, keys, n_keys, results, n_results);
+    rb_grn_context_check(context, self);
+    rb_grn_rc_check(rc, self);
+
+    if (limit > 0) {
+	for (i = 0; i < n_results; i++) {
+	    rb_grn_table_group_limit(context, results[i].table,
+				     sort_by, sort_by_size, sort_flags,
+				     limit, self);
+	}
+    }
+
+    if (n_aggregates > 0) {
+	VALUE rb_aggregates;
+
+	rb_aggregates = rb_grn_table_group_aggregate(context, table,
+						     keys, n_keys,
+						     results,
+						     aggregates, n_aggregates);
+	rb_grn_context_check(context, self);
+	for (i = 0; i < n_results; i++) {
+	    VALUE rb_result = RARRAY_PTR(rb_results)[i];
+
+	    rb_attr(rb_singleton_class(rb_result),
+		    rb_intern("aggregates"),
+		    GRN_TRUE, GRN_FALSE, GRN_FALSE);
+	    rb_iv_set(rb_result, "@aggregates",
+		      RARRAY_PTR(rb_aggregates)[i]);
+	}
+    }
+
+    if (n_results == 1)
+	return rb_ary_pop(rb_results);
+    else
+	return rb_results;
+}
+
+/*
+ * Document-method: []
+ *
+ * call-seq:
+ *   table[id] -> Groonga::Record
+ *
+ * _table_ の _id_ に対応するGroonga::Recordを返す。
+ *
+ * 0.9.0から値ではなくGroonga::Recordを返すようになった。
+ */
+VALUE
+rb_grn_table_array_reference (VALUE self, VALUE rb_id)
+{
+    if (FIXNUM_P(rb_id)) {
+	return rb_grn_record_new_raw(self, rb_id, Qnil);
+    } else {
+	return Qnil;
+    }
+}
+
+VALUE
+rb_grn_table_get_value (VALUE self, VALUE rb_id)
+{
+    grn_id id;
+    grn_ctx *context;
     grn_obj *table;
     grn_obj *range;
     grn_obj *value;
@@ -1337,6 +2589,7 @@ rb_grn_table_set_value (VALUE self, VALUE rb_id, VALUE rb_value)
     grn_obj *value;
     grn_rc rc;
 
+    rb_check_frozen(self);
     rb_grn_table_deconstruct(SELF(self), &table, &context,
 			     NULL, NULL,
 			     &value, NULL, &range,
@@ -1346,6 +2599,7 @@ rb_grn_table_set_value (VALUE self, VALUE rb_id, VALUE rb_value)
     GRN_BULK_REWIND(value);
     RVAL2GRNBULK(rb_value, context, value);
     rc = grn_obj_set_value(context, table, id, value, GRN_OBJ_SET);
+    rb_grn_database_object_modified(table);
     rb_grn_context_check(context, self);
     rb_grn_rc_check(rc, self);
 
@@ -1393,12 +2647,43 @@ rb_grn_table_get_column_value_raw (VALUE self, grn_id id, VALUE rb_name)
 {
     VALUE rb_column;
 
+    rb_check_frozen(self);
     rb_column = rb_grn_table_get_column_surely(self, rb_name);
 
     /* TODO: improve speed. */
     return rb_funcall(rb_column, id_array_reference, 1, INT2NUM(id));
 }
 
+/*
+ * Same as rb_grn_table_get_column_value_raw() but uses _:ids_,
+ * _:packed_ and _:weight_ in _rb_options_ to choose the format of
+ * the returned value.
+ */
+VALUE
+rb_grn_table_get_column_value_with_options (VALUE self, grn_id id,
+					    VALUE rb_name, VALUE rb_options)
+{
+    VALUE rb_column, rb_id, rb_ids, rb_packed, rb_weight;
+
+    rb_grn_scan_options(rb_options,
+			"id", &rb_id,
+			"ids", &rb_ids,
+			"packed", &rb_packed,
+			"weight", &rb_weight,
+			NULL);
+
+    if (!RVAL2CBOOL(rb_ids) && !RVAL2CBOOL(rb_packed) &&
+	!RVAL2CBOOL(rb_weight))
+	return rb_grn_table_get_column_value_raw(self, id, rb_name);
+
+    rb_column = rb_grn_table_get_column_surely(self, rb_name);
+    if (RVAL2CBOOL(rb_packed))
+	return rb_grn_column_get_packed(rb_column, id);
+    if (RVAL2CBOOL(rb_weight))
+	return rb_grn_column_get_with_weight(rb_column, id);
+    return rb_grn_column_get_ids(rb_column, id);
+}
+
 VALUE
 rb_grn_table_get_column_value (VALUE self, VALUE rb_id, VALUE rb_name)
 {
@@ -1411,12 +2696,25 @@ rb_grn_table_get_column_value (VALUE self, VALUE rb_id, VALUE rb_name)
  * call-seq:
  *   table.column_value(id, name) -> 値
  *   table.column_value(id, name, :id => true) -> 値
+ *   table.column_value(id, name, :ids => true) -> ID
  *
  * _table_ の _id_ に対応するカラム _name_ の値を返す。
  *
  * <tt>:id => true</tt>が指定できるのは利便性のため。
  * Groonga::ArrayでもGroonga::HashやGroonga::PatriciaTrieと
  * 同じ引数で動くようになる。
+ *
+ * <tt>:ids => true</tt>を指定すると参照カラムの値を
+ * Groonga::Recordではなく参照先のレコードIDで返す。ベクタの
+ * 場合はIDの配列を返す。
+ *
+ * <tt>:packed => true</tt>を指定すると数値や参照のベクタカラ
+ * ムの値を要素をそのまま並べたバイナリの文字列で返す。
+ * <tt>String#unpack("l*")</tt>などで展開できる。
+ *
+ * <tt>:weight => true</tt>を指定するとベクタカラムの値を
+ * <tt>[値, 重み]</tt>の配列で返す。rroongaで設定したベクタの
+ * 要素の重みは常に0になる。
  */
 static VALUE
 rb_grn_table_get_column_value_convenience (int argc, VALUE *argv, VALUE self)
@@ -1425,9 +2723,12 @@ rb_grn_table_get_column_value_convenience (int argc, VALUE *argv, VALUE self)
 
     rb_scan_args(argc, argv, "21", &rb_id, &rb_name, &rb_options);
     if (!NIL_P(rb_options)) {
-	VALUE rb_option_id;
+	VALUE rb_option_id, rb_option_ids, rb_option_packed, rb_option_weight;
 	rb_grn_scan_options(rb_options,
 			    "id", &rb_option_id,
+			    "ids", &rb_option_ids,
+			    "packed", &rb_option_packed,
+			    "weight", &rb_option_weight,
 			    NULL);
 	if (!(NIL_P(rb_option_id) || RVAL2CBOOL(rb_option_id))) {
 	    rb_raise(rb_eArgError, ":id options must be true or nil: %s: %s",
@@ -1436,6 +2737,10 @@ rb_grn_table_get_column_value_convenience (int argc, VALUE *argv, VALUE self)
 						self,
 						rb_ary_new4(argc, argv))));
 	}
+	return rb_grn_table_get_column_value_with_options(self,
+							  NUM2UINT(rb_id),
+							  rb_name,
+							  rb_options);
     }
 
     return rb_grn_table_get_column_value(self, rb_id, rb_name);
@@ -1701,6 +3006,460 @@ rb_grn_table_is_locked (int argc, VALUE *argv, VALUE self)
     return CBOOL2RVAL(grn_obj_is_locked(context, table));
 }
 
+typedef struct _RbGrnTableSelectPartition RbGrnTableSelectPartition;
+struct _RbGrnTableSelectPartition
+{
+    grn_obj *database;
+    grn_id table_id;
+    const char *query;
+    unsigned int query_size;
+    grn_id default_column_id;
+    const char *default_column_name;
+    unsigned int default_column_name_size;
+    grn_expr_flags flags;
+    grn_id min_id;
+    grn_id max_id;
+    grn_id *ids;
+    int *scores;
+    unsigned int n_ids;
+    grn_rc rc;
+    char message[GRN_CTX_MSGSIZE];
+};
+
+/*
+ * Returns true if selecting by _rb_condition_ may update records.
+ * An expression given by the caller may update records only when
+ * it was parsed with the script syntax allowing update or has an
+ * assignment operation.
+ */
+grn_bool
+rb_grn_table_select_may_update_p (VALUE rb_condition, VALUE rb_syntax,
+				  VALUE rb_allow_update)
+{
+    if (!NIL_P(rb_allow_update) && !RVAL2CBOOL(rb_allow_update))
+	return GRN_FALSE;
+    if (RVAL2CBOOL(rb_obj_is_kind_of(rb_condition, rb_cGrnExpression)))
+	return RVAL2CBOOL(rb_iv_get(rb_condition, "may_update"));
+    if (RVAL2CBOOL(rb_obj_is_kind_of(rb_condition, rb_cString)) &&
+	!NIL_P(rb_syntax) && rb_grn_equal_option(rb_syntax, "script"))
+	return GRN_TRUE;
+    return GRN_FALSE;
+}
+
+static grn_bool
+rb_grn_table_select_true_p (grn_obj *value)
+{
+    if (!value || value->header.type != GRN_BULK)
+	return GRN_FALSE;
+    if (GRN_BULK_VSIZE(value) == 0)
+	return GRN_FALSE;
+
+    switch (value->header.domain) {
+      case GRN_DB_BOOL:
+	return GRN_BOOL_VALUE(value) ? GRN_TRUE : GRN_FALSE;
+      case GRN_DB_INT32:
+	return GRN_INT32_VALUE(value) != 0;
+      case GRN_DB_UINT32:
+	return GRN_UINT32_VALUE(value) != 0;
+      case GRN_DB_INT64:
+	return GRN_INT64_VALUE(value) != 0;
+      case GRN_DB_UINT64:
+	return GRN_UINT64_VALUE(value) != 0;
+      case GRN_DB_FLOAT:
+	return GRN_FLOAT_VALUE(value) != 0.0;
+      default:
+	return GRN_TRUE;
+    }
+}
+
+/* Runs on a worker thread. This must not call Ruby API including
+   xmalloc(). */
+static void *
+rb_grn_table_select_partition_run (void *data)
+{
+    RbGrnTableSelectPartition *partition = data;
+    grn_ctx context;
+    grn_obj *table, *expression, *variable, *default_column = NULL;
+    grn_obj *result = NULL, *score_accessor;
+    grn_obj default_column_name, score;
+    grn_table_cursor *cursor;
+    unsigned int size = 0;
+    grn_id id;
+
+    partition->ids = NULL;
+    partition->scores = NULL;
+    partition->n_ids = 0;
+    partition->rc = GRN_SUCCESS;
+    partition->message[0] = '\0';
+
+    grn_ctx_init(&context, 0);
+    grn_ctx_use(&context, partition->database);
+    GRN_TEXT_INIT(&default_column_name, 0);
+    GRN_INT32_INIT(&score, 0);
+
+    table = grn_ctx_at(&context, partition->table_id);
+    expression = grn_expr_create(&context, NULL, 0);
+    variable = grn_expr_add_var(&context, expression, NULL, 0);
+    GRN_RECORD_INIT(variable, 0, partition->table_id);
+    if (partition->default_column_id != GRN_ID_NIL) {
+	default_column = grn_ctx_at(&context, partition->default_column_id);
+    } else if (partition->default_column_name) {
+	GRN_TEXT_SET(&context, &default_column_name,
+		     partition->default_column_name,
+		     partition->default_column_name_size);
+	default_column = &default_column_name;
+    }
+    partition->rc = grn_expr_parse(&context, expression,
+				   partition->query, partition->query_size,
+				   default_column, GRN_OP_MATCH, GRN_OP_AND,
+				   partition->flags);
+
+    if (partition->rc == GRN_SUCCESS) {
+	result = grn_table_create(&context, NULL, 0, NULL,
+				  GRN_TABLE_HASH_KEY | GRN_OBJ_WITH_SUBREC,
+				  table, NULL);
+	if (!result)
+	    partition->rc = context.rc;
+    }
+    /* Only matched records are added. Then grn_table_select()
+       with GRN_OP_AND against them computes the same scores as
+       the serial select. */
+    for (id = partition->min_id;
+	 partition->rc == GRN_SUCCESS && id <= partition->max_id;
+	 id++) {
+	grn_obj *value;
+
+	if (grn_table_at(&context, table, id) == GRN_ID_NIL)
+	    continue;
+	GRN_RECORD_SET(&context, variable, id);
+	value = grn_expr_exec(&context, expression, 0);
+	partition->rc = context.rc;
+	if (partition->rc == GRN_SUCCESS && rb_grn_table_select_true_p(value))
+	    grn_table_add(&context, result, &id, sizeof(grn_id), NULL);
+    }
+    if (partition->rc == GRN_SUCCESS && grn_table_size(&context, result) > 0) {
+	grn_table_select(&context, table, expression, result, GRN_OP_AND);
+	partition->rc = context.rc;
+    }
+
+    if (partition->rc == GRN_SUCCESS) {
+	size = grn_table_size(&context, result);
+	if (size > 0) {
+	    partition->ids = malloc(sizeof(grn_id) * size);
+	    partition->scores = malloc(sizeof(int) * size);
+	    if (!partition->ids || !partition->scores)
+		partition->rc = GRN_NO_MEMORY_AVAILABLE;
+	}
+    }
+    if (partition->rc == GRN_SUCCESS) {
+	score_accessor = grn_obj_column(&context, result,
+					"_score", strlen("_score"));
+	cursor = grn_table_cursor_open(&context, result, NULL, 0, NULL, 0,
+				       0, -1, GRN_CURSOR_ASCENDING);
+	while (partition->n_ids < size &&
+	       (id = grn_table_cursor_next(&context, cursor)) != GRN_ID_NIL) {
+	    void *key;
+
+	    grn_table_cursor_get_key(&context, cursor, &key);
+	    GRN_BULK_REWIND(&score);
+	    grn_obj_get_value(&context, score_accessor, id, &score);
+	    partition->ids[partition->n_ids] = *((grn_id *)key);
+	    partition->scores[partition->n_ids] = GRN_INT32_VALUE(&score);
+	    partition->n_ids++;
+	}
+	grn_table_cursor_close(&context, cursor);
+	grn_obj_unlink(&context, score_accessor);
+    }
+
+    if (partition->rc != GRN_SUCCESS)
+	strncpy(partition->message, context.errbuf, GRN_CTX_MSGSIZE - 1);
+    partition->message[GRN_CTX_MSGSIZE - 1] = '\0';
+
+    if (result)
+	grn_obj_unlink(&context, result);
+    GRN_OBJ_FIN(&context, &score);
+    GRN_OBJ_FIN(&context, &default_column_name);
+    grn_obj_unlink(&context, expression);
+    grn_ctx_fin(&context);
+
+    return NULL;
+}
+
+static grn_bool
+rb_grn_table_select_column_indexed_p (grn_ctx *context, grn_obj *column)
+{
+    return grn_column_index(context, column, GRN_OP_MATCH,
+			    NULL, 0, NULL) > 0;
+}
+
+/*
+ * Returns true if _table_ or a table that is referred from
+ * _table_ has an index. grn_table_select() may use it.
+ */
+static grn_bool
+rb_grn_table_select_indexed_p (grn_ctx *context, grn_obj *table,
+			       grn_bool follow_reference)
+{
+    grn_obj *columns, *key_accessor;
+    grn_table_cursor *cursor;
+    grn_bool indexed = GRN_FALSE;
+
+    if (table->header.type != GRN_TABLE_NO_KEY) {
+	key_accessor = grn_obj_column(context, table, "_key", strlen("_key"));
+	if (key_accessor) {
+	    indexed = rb_grn_table_select_column_indexed_p(context,
+							    key_accessor);
+	    grn_obj_unlink(context, key_accessor);
+	}
+	if (indexed)
+	    return GRN_TRUE;
+    }
+
+    columns = grn_table_create(context, NULL, 0, NULL, GRN_TABLE_HASH_KEY,
+			       NULL, 0);
+    grn_table_columns(context, table, NULL, 0, columns);
+    cursor = grn_table_cursor_open(context, columns, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while (!indexed && grn_table_cursor_next(context, cursor) != GRN_ID_NIL) {
+	void *key;
+	grn_obj *column, *range;
+
+	grn_table_cursor_get_key(context, cursor, &key);
+	column = grn_ctx_at(context, *((grn_id *)key));
+	if (!column)
+	    continue;
+	if (rb_grn_table_select_column_indexed_p(context, column)) {
+	    indexed = GRN_TRUE;
+	} else if (follow_reference) {
+	    range = grn_ctx_at(context, grn_obj_get_range(context, column));
+	    if (range &&
+		(range->header.type == GRN_TABLE_HASH_KEY ||
+		 range->header.type == GRN_TABLE_PAT_KEY ||
+		 range->header.type == GRN_TABLE_NO_KEY) &&
+		rb_grn_table_select_indexed_p(context, range, GRN_FALSE))
+		indexed = GRN_TRUE;
+	}
+    }
+    grn_table_cursor_close(context, cursor);
+    grn_obj_unlink(context, columns);
+
+    return indexed;
+}
+
+/*
+ * Evaluates _rb_query_ on _n_workers_ native threads that have
+ * their own grn_ctx. Each thread selects records in a range of
+ * record IDs. Returns GRN_FALSE without selecting anything when
+ * the query can't be evaluated in parallel: the query may use
+ * an index, may update records, results are merged by other
+ * than GRN_OP_OR or Groonga::Logger that calls Ruby is
+ * registered.
+ */
+static grn_bool
+rb_grn_table_select_parallel (grn_ctx *context, grn_obj *table,
+			      grn_obj *result, grn_operator operator,
+			      VALUE rb_query,
+			      VALUE rb_syntax, VALUE rb_allow_pragma,
+			      VALUE rb_allow_column, VALUE rb_allow_update,
+			      VALUE rb_default_column, int n_workers,
+			      VALUE self)
+{
+    RbGrnTableSelectPartition *partitions;
+    grn_id table_id, default_column_id = GRN_ID_NIL, max_id;
+    const char *default_column_name = NULL;
+    unsigned int default_column_name_size = 0;
+    grn_expr_flags flags;
+    grn_table_cursor *cursor;
+    grn_obj *score_accessor;
+    grn_obj score;
+    grn_id id;
+    grn_rc rc = GRN_SUCCESS;
+    char message[GRN_CTX_MSGSIZE];
+    int i;
+    unsigned int j;
+
+    if (operator != GRN_OP_OR)
+	return GRN_FALSE;
+    if (!(table->header.flags & GRN_OBJ_PERSISTENT))
+	return GRN_FALSE;
+    /* workers that aren't Ruby threads may log. */
+    if (rb_grn_logger_call_ruby_p())
+	return GRN_FALSE;
+    /* workers must not update records concurrently. */
+    if (rb_grn_table_select_may_update_p(rb_query, rb_syntax,
+					 rb_allow_update))
+	return GRN_FALSE;
+    /* each worker would look up the whole index. */
+    if (rb_grn_table_select_indexed_p(context, table, GRN_TRUE))
+	return GRN_FALSE;
+    table_id = grn_obj_id(context, table);
+
+    if (NIL_P(rb_default_column)) {
+	/* no default column */
+    } else if (RVAL2CBOOL(rb_obj_is_kind_of(rb_default_column,
+					    rb_cGrnObject))) {
+	grn_obj *column;
+
+	column = RVAL2GRNOBJECT(rb_default_column, &context);
+	if (!(column->header.flags & GRN_OBJ_PERSISTENT))
+	    return GRN_FALSE;
+	default_column_id = grn_obj_id(context, column);
+    } else {
+	default_column_name = StringValuePtr(rb_default_column);
+	default_column_name_size = RSTRING_LEN(rb_default_column);
+    }
+
+    if (NIL_P(rb_syntax) || rb_grn_equal_option(rb_syntax, "query")) {
+	flags = GRN_EXPR_SYNTAX_QUERY;
+	if (NIL_P(rb_allow_pragma) || RVAL2CBOOL(rb_allow_pragma))
+	    flags |= GRN_EXPR_ALLOW_PRAGMA;
+	if (NIL_P(rb_allow_column) || RVAL2CBOOL(rb_allow_column))
+	    flags |= GRN_EXPR_ALLOW_COLUMN;
+    } else if (rb_grn_equal_option(rb_syntax, "script")) {
+	flags = GRN_EXPR_SYNTAX_SCRIPT;
+    } else {
+	return GRN_FALSE;
+    }
+
+    /* the first record of a descending cursor by ID has the
+       largest ID. */
+    max_id = GRN_ID_NIL;
+    cursor = grn_table_cursor_open(context, table, NULL, 0, NULL, 0,
+				   0, 1,
+				   GRN_CURSOR_BY_ID | GRN_CURSOR_DESCENDING);
+    if (cursor) {
+	max_id = grn_table_cursor_next(context, cursor);
+	grn_table_cursor_close(context, cursor);
+    }
+    if (max_id == GRN_ID_NIL)
+	return GRN_TRUE;
+    if (n_workers > RB_GRN_MAX_WORKERS)
+	n_workers = RB_GRN_MAX_WORKERS;
+    if ((grn_id)n_workers > max_id)
+	n_workers = max_id;
+
+    partitions = ALLOC_N(RbGrnTableSelectPartition, n_workers);
+    for (i = 0; i < n_workers; i++) {
+	RbGrnTableSelectPartition *partition = &(partitions[i]);
+
+	partition->database = grn_ctx_db(context);
+	partition->table_id = table_id;
+	partition->query = RSTRING_PTR(rb_query);
+	partition->query_size = RSTRING_LEN(rb_query);
+	partition->default_column_id = default_column_id;
+	partition->default_column_name = default_column_name;
+	partition->default_column_name_size = default_column_name_size;
+	partition->flags = flags;
+	partition->min_id = (grn_id)(((uint64_t)max_id * i) / n_workers) + 1;
+	partition->max_id = (grn_id)(((uint64_t)max_id * (i + 1)) / n_workers);
+    }
+    rb_grn_run_workers(rb_grn_table_select_partition_run,
+		       partitions, sizeof(RbGrnTableSelectPartition),
+		       n_workers);
+
+    for (i = 0; i < n_workers; i++) {
+	if (partitions[i].rc != GRN_SUCCESS) {
+	    rc = partitions[i].rc;
+	    strcpy(message, partitions[i].message);
+	    break;
+	}
+    }
+
+    score_accessor = grn_obj_column(context, result,
+				    "_score", strlen("_score"));
+    GRN_INT32_INIT(&score, 0);
+    for (i = 0; i < n_workers; i++) {
+	RbGrnTableSelectPartition *partition = &(partitions[i]);
+
+	for (j = 0; rc == GRN_SUCCESS && j < partition->n_ids; j++) {
+	    id = grn_table_add(context, result,
+			       &(partition->ids[j]), sizeof(grn_id), NULL);
+	    if (id == GRN_ID_NIL)
+		continue;
+	    GRN_INT32_SET(context, &score, partition->scores[j]);
+	    grn_obj_set_value(context, score_accessor, id, &score,
+			      GRN_OBJ_SET);
+	}
+	free(partition->ids);
+	free(partition->scores);
+    }
+    GRN_OBJ_FIN(context, &score);
+    grn_obj_unlink(context, score_accessor);
+    xfree(partitions);
+
+    if (rc != GRN_SUCCESS)
+	rb_raise(rb_grn_rc_to_exception(rc), "%s: %s: <%s>",
+		 rb_grn_rc_to_message(rc), message, rb_grn_inspect(self));
+    rb_grn_context_check(context, self);
+    return GRN_TRUE;
+}
+
+static grn_obj *
+rb_grn_table_open_score_accessor (grn_ctx *context, grn_obj *table)
+{
+    if (!(table->header.flags & GRN_OBJ_WITH_SUBREC))
+	return NULL;
+    return grn_obj_column(context, table, "_score", strlen("_score"));
+}
+
+static int
+rb_grn_table_get_score (grn_ctx *context, grn_obj *score_accessor,
+			grn_id id, grn_obj *buffer)
+{
+    if (!score_accessor)
+	return 0;
+    GRN_BULK_REWIND(buffer);
+    grn_obj_get_value(context, score_accessor, id, buffer);
+    if (GRN_BULK_VSIZE(buffer) == 0)
+	return 0;
+    return GRN_INT32_VALUE(buffer);
+}
+
+static void
+rb_grn_table_set_score (grn_ctx *context, grn_obj *score_accessor,
+			grn_id id, int score)
+{
+    grn_obj value;
+
+    if (!score_accessor)
+	return;
+    GRN_INT32_INIT(&value, 0);
+    GRN_INT32_SET(context, &value, score);
+    grn_obj_set_value(context, score_accessor, id, &value, GRN_OBJ_SET);
+    GRN_OBJ_FIN(context, &value);
+}
+
+typedef struct _RbGrnTableAddIdData RbGrnTableAddIdData;
+struct _RbGrnTableAddIdData
+{
+    grn_ctx *context;
+    grn_obj *table;
+    grn_obj *source;
+    grn_obj *score;
+    int score_value;
+};
+
+/* Adds a record for _id_ to the result table. New records have
+   the score. IDs that aren't in the source table are ignored if
+   the source table is given. */
+static grn_bool
+rb_grn_table_add_id (grn_id id, void *user_data)
+{
+    RbGrnTableAddIdData *data = user_data;
+    grn_id result_id;
+    int added = 0;
+
+    if (data->source &&
+	grn_table_at(data->context, data->source, id) == GRN_ID_NIL)
+	return GRN_TRUE;
+    result_id = grn_table_add(data->context, data->table,
+			      &id, sizeof(grn_id), &added);
+    if (result_id != GRN_ID_NIL && added)
+	rb_grn_table_set_score(data->context, data->score, result_id,
+			       data->score_value);
+    return GRN_TRUE;
+}
+
 /*
  * call-seq:
  *   table.select(options) {|record| ...} -> Groonga::Hash
@@ -1759,6 +3518,11 @@ rb_grn_table_is_locked (int argc, VALUE *argv, VALUE self)
  *                          # "groonga"を含んでいるレコードにマッチ==
  * </pre>
  *
+ * 文字列で指定した条件は毎回Groonga::Expressionにパースさ
+ * れる。 +:reuse_expression+ を指定したときだけ、テーブルご
+ * とに最近使った32個までの式を保持し、同じ _query_ とオプショ
+ * ンで検索したときに再利用する。
+ *
  * _expression_ には既に作成済みのGroonga::Expressionを渡す
  *
  * ブロックで条件を指定する場合は
@@ -1839,7 +3603,195 @@ rb_grn_table_is_locked (int argc, VALUE *argv, VALUE self)
  *   は利用する。
  *
  *   参考: Groonga::Expression#parse.
+ *
+ * @option options :cache The cache
+ *
+ *   +true+ を指定すると _query_ とオプションが同じ検索の結果
+ *   をキャッシュし、次からは検索せずにキャッシュした結果を返
+ *   す。結果は共有されるので凍結されていて、レコードの追加や
+ *   削除など変更するメソッドを呼ぶと例外が発生する。変更した
+ *   い場合は集合演算で別のテーブルにコピーすること。
+ *   +:id_bitmap+ と一緒に使った場合は凍結された
+ *   Groonga::IdBitmapを返す。キャッシュは
+ *   Groonga::Database#modification_countが変わると無効になる。
+ *   rroonga以外からの変更は検出できない。 _query_ を文字列で
+ *   指定したときだけ使える。 +:result+ とは一緒に使えない。
+ *
+ * @option options :parallel The parallel
+ *
+ *   2以上を指定するとレコードをID順に _:parallel_ 個の範囲に
+ *   分割し、それぞれの範囲をスレッドごとに別のコンテキストで
+ *   検索する。64より大きい値は64とみなす。結果とスコアは並
+ *   列にしない場合と同じ。インデックスがない大きなテーブル
+ *   を検索する場合に速い。 _query_ を文字列で指定し、
+ *   +:result+ と +:operator+ を指定せず、 _table_ が永続テー
+ *   ブルで、 _table_ と _table_ から参照しているテーブルにイ
+ *   ンデックスがなく、更新操作を使わない（ +:syntax+ が
+ *   +:script+ のときは +:allow_update+ に +false+ を指定す
+ *   る）ときだけ有効で、それ以外の場合は無視される。バッファ
+ *   しないGroonga::Loggerを登録している場合も無視される。
+ *
+ * @option options :reuse_expression The reuse_expression
+ *
+ *   +true+ を指定すると _query_ とオプションが同じときに前回
+ *   パースした式を再利用する。パースを省略できるので同じ
+ *   _query_ で何度も検索する場合に速い。式が参照しているテー
+ *   ブルやカラムを削除すると再利用しなくなるが、検出できるの
+ *   はGroonga::Object#removeかGroonga::Context#sendで削除し
+ *   た場合だけ。rroonga以外から削除した場合は検出できないの
+ *   で、スキーマが変わらないときだけ使うこと。省略した場合は
+ *   毎回パースする。 _query_ を文字列で指定したときだけ使え
+ *   る。
+ *
+ * @option options :id_bitmap The id_bitmap
+ *
+ *   +true+ を指定すると結果のテーブルではなく、マッチしたレ
+ *   コードのIDを持つGroonga::IdBitmapを返す。スコアは使えな
+ *   くなるが、結果を長い間保持する場合や集合演算に使う場合は
+ *   ずっと小さく速い。 +:result+ とは一緒に使えない。
+ *
+ * @option options :ids The ids
+ *
+ *   Groonga::IdBitmapを指定するとそのIDのレコードだけを検索
+ *   する。 +:id_bitmap+ で作った前回の検索結果をさらに絞り込
+ *   む場合に使う。スコアは指定しない場合と同じ。 +:result+ ,
+ *   +:operator+ , +:cache+ とは一緒に使えない。
  */
+#define RB_GRN_TABLE_SELECT_CACHE_MAX_ENTRIES 100
+#define RB_GRN_TABLE_EXPRESSION_CACHE_MAX_ENTRIES 32
+
+static VALUE
+rb_grn_table_expression_cache_key (VALUE rb_query, VALUE rb_name,
+				   VALUE rb_syntax, VALUE rb_allow_pragma,
+				   VALUE rb_allow_column, VALUE rb_allow_update,
+				   VALUE rb_default_column)
+{
+    VALUE key;
+
+    if (RVAL2CBOOL(rb_obj_is_kind_of(rb_default_column, rb_cGrnObject)))
+	rb_default_column = rb_funcall(rb_default_column, rb_intern("name"), 0);
+
+    key = rb_ary_new();
+    rb_ary_push(key, rb_funcall(rb_query, rb_intern("strip"), 0));
+    rb_ary_push(key, rb_name);
+    rb_ary_push(key, rb_syntax);
+    rb_ary_push(key, rb_allow_pragma);
+    rb_ary_push(key, rb_allow_column);
+    rb_ary_push(key, rb_allow_update);
+    rb_ary_push(key, rb_default_column);
+    return key;
+}
+
+static VALUE
+rb_grn_table_expression_cache_fetch (VALUE self, VALUE key)
+{
+    VALUE cache, entry, rb_expression;
+
+    cache = rb_iv_get(self, "@expression_cache");
+    if (NIL_P(cache))
+	return Qnil;
+
+    entry = rb_hash_delete(cache, key);
+    if (NIL_P(entry))
+	return Qnil;
+
+    rb_expression = RARRAY_PTR(entry)[1];
+    if (NUM2ULONG(RARRAY_PTR(entry)[0]) !=
+	rb_grn_database_schema_modification_count() ||
+	RVAL2CBOOL(rb_grn_object_closed_p(rb_expression))) {
+	return Qnil;
+    }
+
+    /* re-insert to mark as the most recently used entry. */
+    rb_hash_aset(cache, key, entry);
+    return rb_expression;
+}
+
+static void
+rb_grn_table_expression_cache_store (VALUE self, VALUE key,
+				     VALUE rb_expression)
+{
+    VALUE cache, entry;
+
+    /* A cached result is frozen and shared. It isn't cached. */
+    if (OBJ_FROZEN(self))
+	return;
+
+    cache = rb_iv_get(self, "@expression_cache");
+    if (NIL_P(cache)) {
+	cache = rb_hash_new();
+	rb_iv_set(self, "@expression_cache", cache);
+    }
+
+    /* Hash keeps insertion order. The first entry is the least
+       recently used one. */
+    if (NUM2INT(rb_funcall(cache, rb_intern("size"), 0)) >=
+	RB_GRN_TABLE_EXPRESSION_CACHE_MAX_ENTRIES)
+	rb_funcall(cache, rb_intern("shift"), 0);
+
+    entry = rb_ary_new3(2,
+			ULONG2NUM(rb_grn_database_schema_modification_count()),
+			rb_expression);
+    rb_hash_aset(cache, key, entry);
+}
+
+static VALUE
+rb_grn_table_select_cache_fetch (VALUE self, VALUE key)
+{
+    VALUE cache, entry, rb_result;
+
+    cache = rb_iv_get(self, "@select_cache");
+    if (NIL_P(cache))
+	return Qnil;
+
+    entry = rb_hash_aref(cache, key);
+    if (NIL_P(entry))
+	return Qnil;
+
+    rb_result = RARRAY_PTR(entry)[1];
+    if (NUM2ULONG(RARRAY_PTR(entry)[0]) !=
+	rb_grn_database_modification_count() ||
+	(RVAL2CBOOL(rb_obj_is_kind_of(rb_result, rb_cGrnObject)) &&
+	 RVAL2CBOOL(rb_grn_object_closed_p(rb_result)))) {
+	rb_hash_delete(cache, key);
+	return Qnil;
+    }
+
+    return rb_result;
+}
+
+static void
+rb_grn_table_select_cache_store (VALUE self, VALUE key, VALUE rb_result,
+				 unsigned long modification_count)
+{
+    VALUE cache, entry;
+
+    if (OBJ_FROZEN(self))
+	return;
+
+    cache = rb_iv_get(self, "@select_cache");
+    if (NIL_P(cache)) {
+	cache = rb_hash_new();
+	rb_iv_set(self, "@select_cache", cache);
+    }
+
+    if (NUM2INT(rb_funcall(cache, rb_intern("size"), 0)) >=
+	RB_GRN_TABLE_SELECT_CACHE_MAX_ENTRIES)
+	rb_funcall(cache, rb_intern("clear"), 0);
+
+    entry = rb_ary_new3(2, ULONG2NUM(modification_count), rb_result);
+    rb_hash_aset(cache, key, entry);
+}
+
+static void
+rb_grn_table_select_set_expression (VALUE rb_result, VALUE rb_expression)
+{
+    rb_attr(rb_singleton_class(rb_result),
+	    rb_intern("expression"),
+	    GRN_TRUE, GRN_FALSE, GRN_FALSE);
+    rb_iv_set(rb_result, "@expression", rb_expression);
+}
+
 static VALUE
 rb_grn_table_select (int argc, VALUE *argv, VALUE self)
 {
@@ -1849,8 +3801,12 @@ rb_grn_table_select (int argc, VALUE *argv, VALUE self)
     VALUE rb_query = Qnil, condition_or_options, options;
     VALUE rb_name, rb_operator, rb_result, rb_syntax;
     VALUE rb_allow_pragma, rb_allow_column, rb_allow_update;
-    VALUE rb_default_column;
+    VALUE rb_default_column, rb_cache, rb_parallel, rb_id_bitmap;
+    VALUE rb_reuse_expression, rb_ids;
     VALUE rb_expression = Qnil, builder;
+    VALUE cache_key = Qnil, expression_cache_key = Qnil;
+    unsigned long modification_count = 0;
+    grn_bool selected = GRN_FALSE;
 
     rb_scan_args(argc, argv, "02", &condition_or_options, &options);
 
@@ -1883,8 +3839,57 @@ rb_grn_table_select (int argc, VALUE *argv, VALUE self)
 			"allow_column", &rb_allow_column,
 			"allow_update", &rb_allow_update,
 			"default_column", &rb_default_column,
+			"cache", &rb_cache,
+			"parallel", &rb_parallel,
+			"id_bitmap", &rb_id_bitmap,
+			"reuse_expression", &rb_reuse_expression,
+			"ids", &rb_ids,
 			NULL);
 
+    if (!NIL_P(rb_ids)) {
+	if (!RVAL2CBOOL(rb_obj_is_kind_of(rb_ids, rb_cGrnIdBitmap)))
+	    rb_raise(rb_eArgError, ":ids should be Groonga::IdBitmap: %s",
+		     rb_grn_inspect(rb_ids));
+	if (!NIL_P(rb_result) || !NIL_P(rb_operator) || RVAL2CBOOL(rb_cache))
+	    rb_raise(rb_eArgError,
+		     "should not pass :ids with :result, :operator "
+		     "or :cache: %s",
+		     rb_grn_inspect(rb_ary_new4(argc, argv)));
+    }
+
+    if (RVAL2CBOOL(rb_id_bitmap) && !NIL_P(rb_result))
+	rb_raise(rb_eArgError,
+		 "should not pass both of :id_bitmap and :result: %s",
+		 rb_grn_inspect(rb_ary_new4(argc, argv)));
+
+    if (RVAL2CBOOL(rb_cache)) {
+	VALUE rb_cached_result;
+
+	if (NIL_P(rb_query) || rb_block_given_p())
+	    rb_raise(rb_eArgError,
+		     ":cache is available only for query string: %s",
+		     rb_grn_inspect(rb_ary_new4(argc, argv)));
+	if (!NIL_P(rb_result))
+	    rb_raise(rb_eArgError,
+		     "should not pass both of :cache and :result: %s",
+		     rb_grn_inspect(rb_ary_new4(argc, argv)));
+
+	cache_key = rb_ary_new3(3,
+				rb_grn_table_expression_cache_key(rb_query,
+								  rb_name,
+								  rb_syntax,
+								  rb_allow_pragma,
+								  rb_allow_column,
+								  rb_allow_update,
+								  rb_default_column),
+				rb_operator,
+				CBOOL2RVAL(RVAL2CBOOL(rb_id_bitmap)));
+	rb_cached_result = rb_grn_table_select_cache_fetch(self, cache_key);
+	if (!NIL_P(rb_cached_result))
+	    return rb_cached_result;
+	modification_count = rb_grn_database_modification_count();
+    }
+
     if (!NIL_P(rb_operator))
 	operator = NUM2INT(rb_operator);
 
@@ -1894,10 +3899,56 @@ rb_grn_table_select (int argc, VALUE *argv, VALUE self)
 				  table,
 				  NULL);
 	rb_result = GRNTABLE2RVAL(context, result, GRN_TRUE);
+	if (!NIL_P(rb_ids)) {
+	    RbGrnTableAddIdData data;
+
+	    /* grn_table_select() with GRN_OP_AND keeps only records
+	       in the bitmap and adds scores to the initial 0. */
+	    data.context = context;
+	    data.table = result;
+	    data.source = table;
+	    data.score = rb_grn_table_open_score_accessor(context, result);
+	    data.score_value = 0;
+	    rb_grn_id_bitmap_each_raw(rb_ids, rb_grn_table_add_id, &data);
+	    if (data.score)
+		grn_obj_unlink(context, data.score);
+	    rb_grn_context_check(context, self);
+	    operator = GRN_OP_AND;
+	} else if (!NIL_P(rb_parallel) && NUM2INT(rb_parallel) > 1 &&
+		   !NIL_P(rb_query) && !rb_block_given_p()) {
+	    selected = rb_grn_table_select_parallel(context, table, result,
+						    operator,
+						    rb_query,
+						    rb_syntax,
+						    rb_allow_pragma,
+						    rb_allow_column,
+						    rb_allow_update,
+						    rb_default_column,
+						    NUM2INT(rb_parallel),
+						    self);
+	}
     } else {
+	rb_check_frozen(rb_result);
 	result = RVAL2GRNTABLE(rb_result, &context);
     }
 
+    if (NIL_P(rb_expression) && !NIL_P(rb_query) && !rb_block_given_p() &&
+	RVAL2CBOOL(rb_reuse_expression)) {
+	if (NIL_P(cache_key)) {
+	    expression_cache_key =
+		rb_grn_table_expression_cache_key(rb_query, rb_name,
+						  rb_syntax,
+						  rb_allow_pragma,
+						  rb_allow_column,
+						  rb_allow_update,
+						  rb_default_column);
+	} else {
+	    expression_cache_key = rb_ary_entry(cache_key, 0);
+	}
+	rb_expression = rb_grn_table_expression_cache_fetch(self,
+							    expression_cache_key);
+    }
+
     if (NIL_P(rb_expression)) {
       builder = rb_grn_record_expression_builder_new(self, rb_name);
       rb_funcall(builder, rb_intern("query="), 1, rb_query);
@@ -1907,22 +3958,333 @@ rb_grn_table_select (int argc, VALUE *argv, VALUE self)
       rb_funcall(builder, rb_intern("allow_update="), 1, rb_allow_update);
       rb_funcall(builder, rb_intern("default_column="), 1, rb_default_column);
       rb_expression = rb_grn_record_expression_builder_build(builder);
+      if (!NIL_P(expression_cache_key))
+	  rb_grn_table_expression_cache_store(self, expression_cache_key,
+					      rb_expression);
     }
     rb_grn_object_deconstruct(RB_GRN_OBJECT(DATA_PTR(rb_expression)),
                               &expression, NULL,
 			      NULL, NULL, NULL, NULL);
 
-    grn_table_select(context, table, expression, result, operator);
-    rb_grn_context_check(context, self);
+    if (!selected) {
+	grn_table_select(context, table, expression, result, operator);
+	if (rb_grn_table_select_may_update_p(condition_or_options, rb_syntax,
+					     rb_allow_update))
+	    rb_grn_database_object_modified(table);
+	rb_grn_context_check(context, self);
+    }
 
-    rb_attr(rb_singleton_class(rb_result),
-	    rb_intern("expression"),
-	    GRN_TRUE, GRN_FALSE, GRN_FALSE);
-    rb_iv_set(rb_result, "@expression", rb_expression);
+    if (RVAL2CBOOL(rb_id_bitmap)) {
+	VALUE rb_bitmap;
+
+	rb_bitmap = rb_grn_id_bitmap_new_from_table(context, result);
+	rb_grn_object_close(rb_result);
+	if (!NIL_P(cache_key)) {
+	    OBJ_FREEZE(rb_bitmap);
+	    rb_grn_table_select_cache_store(self, cache_key, rb_bitmap,
+					    modification_count);
+	}
+	return rb_bitmap;
+    }
+
+    rb_grn_table_select_set_expression(rb_result, rb_expression);
+
+    if (!NIL_P(cache_key)) {
+	OBJ_FREEZE(rb_result);
+	rb_grn_table_select_cache_store(self, cache_key, rb_result,
+					modification_count);
+    }
 
     return rb_result;
 }
 
+typedef struct _RbGrnTableSelectEachData RbGrnTableSelectEachData;
+struct _RbGrnTableSelectEachData
+{
+    grn_ctx *context;
+    grn_obj *expression;
+    grn_obj *variable;
+    grn_table_cursor *cursor;
+    grn_obj *result;
+    grn_obj *score;
+    grn_obj score_buffer;
+    int limit;
+    grn_bool may_update;
+    VALUE self;
+    VALUE rb_cursor;
+    VALUE rb_result;
+};
+
+static VALUE
+rb_grn_table_select_each_body (VALUE user_data)
+{
+    RbGrnTableSelectEachData *data = (RbGrnTableSelectEachData *)user_data;
+    grn_ctx *context = data->context;
+    grn_id id;
+    int n_yielded = 0;
+
+    while ((id = grn_table_cursor_next(context, data->cursor)) !=
+	   GRN_ID_NIL) {
+	grn_id record_id = id;
+	int score = 1;
+
+	if (data->result) {
+	    void *key;
+
+	    grn_table_cursor_get_key(context, data->cursor, &key);
+	    record_id = *((grn_id *)key);
+	    score = rb_grn_table_get_score(context, data->score, id,
+					   &(data->score_buffer));
+	} else {
+	    grn_obj *value;
+
+	    GRN_RECORD_SET(context, data->variable, id);
+	    value = grn_expr_exec(context, data->expression, 0);
+	    if (data->may_update)
+		rb_grn_database_object_modified(
+		    grn_table_cursor_table(context, data->cursor));
+	    rb_grn_context_check(context, data->self);
+	    if (!rb_grn_table_select_true_p(value))
+		continue;
+	}
+
+	rb_yield_values(2, UINT2NUM(record_id), INT2NUM(score));
+	n_yielded++;
+	if (data->limit > 0 && n_yielded >= data->limit)
+	    break;
+    }
+
+    return Qnil;
+}
+
+static VALUE
+rb_grn_table_select_each_ensure (VALUE user_data)
+{
+    RbGrnTableSelectEachData *data = (RbGrnTableSelectEachData *)user_data;
+
+    rb_grn_object_close(data->rb_cursor);
+    if (data->score)
+	grn_obj_unlink(data->context, data->score);
+    GRN_OBJ_FIN(data->context, &(data->score_buffer));
+    if (!NIL_P(data->rb_result))
+	rb_grn_object_close(data->rb_result);
+
+    return Qnil;
+}
+
+/*
+ * call-seq:
+ *   table.select_each(query, options={}) {|id, score| ...}
+ *   table.select_each(expression, options={}) {|id, score| ...}
+ *
+ * _query_ にマッチしたレコードのIDとスコアを見つけた順にブロッ
+ * クに渡す。 #select と違って検索結果のテーブルを作らない。
+ * ブロックから +break+ するか +:limit+ 件渡すとそこで検索をや
+ * める。マッチするレコードがあるかどうかを調べる場合や、ソート
+ * しなくてよいので最初の数件だけが欲しい場合に速い。
+ *
+ * _table_ と _table_ から参照しているテーブルにインデックス
+ * がない場合はレコードをID順に1件ずつ評価し、スコアは常に1
+ * になる。インデックスがある場合はインデックスを使えるよう
+ * に #select と同じ方法で一時テーブルに検索してから渡すので、
+ * スコアは #select と同じになるが、最初のレコードを渡すまで
+ * に全てのマッチするレコードを検索する。ブロックから例外が
+ * 発生した場合も途中で作ったカーソルと一時テーブルは閉じる。
+ * ブロックを省略した場合はEnumeratorを返す。
+ *
+ * _options_ に指定可能な値は以下の通り。 +:name+ , +:syntax+ ,
+ * +:allow_pragma+ , +:allow_column+ , +:allow_update+ ,
+ * +:default_column+ , +:reuse_expression+ は #select と同じ。
+ *
+ * @option options :limit The limit
+ *
+ *   ブロックに渡すレコードの最大数。省略した場合はマッチし
+ *   た全てのレコードを渡す。
+ *
+ * @example
+ *   comments.select_each("content:@Hello", :limit => 10) do |id, score|
+ *     p comments[id]
+ *   end
+ *   exist = false
+ *   comments.select_each("content:@Hello") {exist = true; break}
+ */
+static VALUE
+rb_grn_table_select_each (int argc, VALUE *argv, VALUE self)
+{
+    grn_ctx *context;
+    grn_obj *table, *expression, *variable;
+    int limit = -1;
+    VALUE rb_query, options, rb_cursor;
+    VALUE rb_name, rb_syntax, rb_limit;
+    VALUE rb_allow_pragma, rb_allow_column, rb_allow_update;
+    VALUE rb_default_column, rb_reuse_expression;
+    VALUE rb_expression = Qnil, expression_cache_key = Qnil;
+    grn_bool may_update;
+    RbGrnTableSelectEachData data;
+
+    RETURN_ENUMERATOR(self, argc, argv);
+
+    rb_scan_args(argc, argv, "11", &rb_query, &options);
+
+    rb_grn_table_deconstruct(SELF(self), &table, &context,
+			     NULL, NULL,
+			     NULL, NULL, NULL,
+			     NULL);
+
+    rb_grn_scan_options(options,
+			"name", &rb_name,
+			"syntax", &rb_syntax,
+			"allow_pragma", &rb_allow_pragma,
+			"allow_column", &rb_allow_column,
+			"allow_update", &rb_allow_update,
+			"default_column", &rb_default_column,
+			"limit", &rb_limit,
+			"reuse_expression", &rb_reuse_expression,
+			NULL);
+
+    if (!NIL_P(rb_limit))
+	limit = NUM2INT(rb_limit);
+    if (limit == 0)
+	return self;
+    may_update = rb_grn_table_select_may_update_p(rb_query, rb_syntax,
+						  rb_allow_update);
+
+    if (RVAL2CBOOL(rb_obj_is_kind_of(rb_query, rb_cGrnExpression))) {
+	rb_expression = rb_query;
+    } else if (RVAL2CBOOL(rb_obj_is_kind_of(rb_query, rb_cString))) {
+	if (RVAL2CBOOL(rb_reuse_expression)) {
+	    expression_cache_key =
+		rb_grn_table_expression_cache_key(rb_query, rb_name,
+						  rb_syntax,
+						  rb_allow_pragma,
+						  rb_allow_column,
+						  rb_allow_update,
+						  rb_default_column);
+	    rb_expression =
+		rb_grn_table_expression_cache_fetch(self,
+						    expression_cache_key);
+	}
+    } else {
+	rb_raise(rb_eArgError,
+		 "should be query string or expression: %s",
+		 rb_grn_inspect(rb_query));
+    }
+
+    if (NIL_P(rb_expression)) {
+	VALUE builder;
+
+	builder = rb_grn_record_expression_builder_new(self, rb_name);
+	rb_funcall(builder, rb_intern("query="), 1, rb_query);
+	rb_funcall(builder, rb_intern("syntax="), 1, rb_syntax);
+	rb_funcall(builder, rb_intern("allow_pragma="), 1, rb_allow_pragma);
+	rb_funcall(builder, rb_intern("allow_column="), 1, rb_allow_column);
+	rb_funcall(builder, rb_intern("allow_update="), 1, rb_allow_update);
+	rb_funcall(builder, rb_intern("default_column="), 1,
+		   rb_default_column);
+	/* don't use the given block to build expression. */
+	rb_expression = rb_funcall(builder, rb_intern("build"), 0);
+	if (!NIL_P(expression_cache_key))
+	    rb_grn_table_expression_cache_store(self, expression_cache_key,
+						rb_expression);
+    }
+    rb_grn_object_deconstruct(RB_GRN_OBJECT(DATA_PTR(rb_expression)),
+			      &expression, NULL,
+			      NULL, NULL, NULL, NULL);
+    variable = grn_expr_get_var_by_offset(context, expression, 0);
+    if (!variable)
+	rb_raise(rb_eArgError,
+		 "expression should have a record variable: %s",
+		 rb_grn_inspect(rb_expression));
+
+    data.context = context;
+    data.expression = expression;
+    data.variable = variable;
+    data.result = NULL;
+    data.score = NULL;
+    data.rb_result = Qnil;
+    /* Evaluating records one by one can't use indexes. */
+    if (rb_grn_table_select_indexed_p(context, table, GRN_TRUE)) {
+	data.result = grn_table_create(context, NULL, 0, NULL,
+				       GRN_TABLE_HASH_KEY | GRN_OBJ_WITH_SUBREC,
+				       table, NULL);
+	rb_grn_context_check(context, self);
+	data.rb_result = GRNTABLE2RVAL(context, data.result, GRN_TRUE);
+	grn_table_select(context, table, expression, data.result, GRN_OP_OR);
+	if (may_update)
+	    rb_grn_database_object_modified(table);
+	rb_grn_context_check(context, self);
+	data.score = rb_grn_table_open_score_accessor(context, data.result);
+    }
+    data.cursor = grn_table_cursor_open(context,
+					data.result ? data.result : table,
+					NULL, 0, NULL, 0,
+					0, -1, GRN_CURSOR_ASCENDING);
+    rb_grn_context_check(context, self);
+    data.limit = limit;
+    data.may_update = may_update;
+    data.self = self;
+    rb_cursor = GRNTABLECURSOR2RVAL(Qnil, context, data.cursor);
+    data.rb_cursor = rb_cursor;
+    GRN_INT32_INIT(&(data.score_buffer), 0);
+    rb_ensure(rb_grn_table_select_each_body, (VALUE)&data,
+	      rb_grn_table_select_each_ensure, (VALUE)&data);
+
+    return self;
+}
+
+/*
+ * Applies _operator_ to _table_ with IDs in _rb_bitmap_. IDs
+ * are compared with IDs of source records for a result table
+ * and with record IDs for other tables.
+ */
+static void
+rb_grn_table_set_operation_by_id_bitmap (grn_ctx *context, grn_obj *table,
+					 VALUE rb_bitmap,
+					 grn_operator operator)
+{
+    grn_table_cursor *cursor;
+    grn_id id;
+    grn_bool use_key;
+
+    use_key = (table->header.flags & GRN_OBJ_WITH_SUBREC) &&
+	table->header.type != GRN_TABLE_NO_KEY;
+
+    if (operator == GRN_OP_OR) {
+	RbGrnTableAddIdData data;
+
+	if (!use_key)
+	    rb_raise(rb_eArgError,
+		     "only result table can be unioned with ID bitmap");
+	data.context = context;
+	data.table = table;
+	data.source = NULL;
+	data.score = rb_grn_table_open_score_accessor(context, table);
+	data.score_value = 1;
+	rb_grn_id_bitmap_each_raw(rb_bitmap, rb_grn_table_add_id, &data);
+	if (data.score)
+	    grn_obj_unlink(context, data.score);
+	return;
+    }
+
+    cursor = grn_table_cursor_open(context, table, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	grn_bool included;
+
+	if (use_key) {
+	    void *key;
+
+	    grn_table_cursor_get_key(context, cursor, &key);
+	    included = rb_grn_id_bitmap_include(rb_bitmap, *((grn_id *)key));
+	} else {
+	    included = rb_grn_id_bitmap_include(rb_bitmap, id);
+	}
+	if (operator == GRN_OP_AND ? !included : included)
+	    grn_table_cursor_delete(context, cursor);
+    }
+    grn_table_cursor_close(context, cursor);
+}
+
 static VALUE
 rb_grn_table_set_operation_bang (VALUE self, VALUE rb_other,
 				 grn_operator operator)
@@ -1931,16 +4293,26 @@ rb_grn_table_set_operation_bang (VALUE self, VALUE rb_other,
     grn_obj *table, *other;
     grn_rc rc;
 
+    rb_check_frozen(self);
     rb_grn_table_deconstruct(SELF(self), &table, &context,
 			     NULL, NULL,
 			     NULL, NULL, NULL,
 			     NULL);
+    if (operator != GRN_OP_ADJUST &&
+	RVAL2CBOOL(rb_obj_is_kind_of(rb_other, rb_cGrnIdBitmap))) {
+	rb_grn_table_set_operation_by_id_bitmap(context, table, rb_other,
+						operator);
+	rb_grn_database_object_modified(table);
+	rb_grn_context_check(context, self);
+	return self;
+    }
     rb_grn_table_deconstruct(SELF(rb_other), &other, NULL,
 			     NULL, NULL,
 			     NULL, NULL, NULL,
 			     NULL);
 
     rc = grn_table_setoperation(context, table, other, table, operator);
+    rb_grn_database_object_modified(table);
     rb_grn_context_check(context, self);
     rb_grn_rc_check(rc, self);
 
@@ -1954,6 +4326,9 @@ rb_grn_table_set_operation_bang (VALUE self, VALUE rb_other,
  * キーを比較し、 _table_ には登録されていない _other_ のレコー
  * ドを _table_ に作成する。
  *
+ * _other_ にはGroonga::IdBitmapも指定できる。この場合、
+ * _table_ は検索結果のテーブルでなければならず、 _other_ の
+ * IDのレコードをスコア1で追加する。
  */
 static VALUE
 rb_grn_table_union_bang (VALUE self, VALUE rb_other)
@@ -1962,6 +4337,131 @@ rb_grn_table_union_bang (VALUE self, VALUE rb_other)
 }
 
 
+/*
+ * Same as grn_table_setoperation(GRN_OP_AND) but looks up
+ * _other_ records in _table_ instead of _table_ records in
+ * _other_ and adds scores of _other_. This is faster when
+ * _other_ is much smaller than _table_.
+ */
+static void
+rb_grn_table_intersect_by_other (grn_ctx *context,
+				 grn_obj *table, grn_obj *other)
+{
+    grn_table_cursor *cursor;
+    grn_obj *table_score, *other_score;
+    grn_obj score;
+    grn_id id, *matched_ids, max_matched_id = GRN_ID_NIL;
+    unsigned int i, n_matched_ids = 0;
+    char *matched;
+
+    table_score = rb_grn_table_open_score_accessor(context, table);
+    other_score = rb_grn_table_open_score_accessor(context, other);
+    GRN_VOID_INIT(&score);
+
+    matched_ids = ALLOC_N(grn_id, grn_table_size(context, other) + 1);
+    cursor = grn_table_cursor_open(context, other, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	void *key;
+	int key_size;
+	grn_id table_id;
+
+	key_size = grn_table_cursor_get_key(context, cursor, &key);
+	table_id = grn_table_get(context, table, key, key_size);
+	if (table_id == GRN_ID_NIL)
+	    continue;
+
+	matched_ids[n_matched_ids++] = table_id;
+	if (table_id > max_matched_id)
+	    max_matched_id = table_id;
+	if (table_score && other_score) {
+	    int table_score_value, other_score_value;
+
+	    table_score_value = rb_grn_table_get_score(context, table_score,
+						       table_id, &score);
+	    other_score_value = rb_grn_table_get_score(context, other_score,
+						       id, &score);
+	    rb_grn_table_set_score(context, table_score, table_id,
+				   table_score_value + other_score_value);
+	}
+    }
+    grn_table_cursor_close(context, cursor);
+
+    matched = ALLOC_N(char, max_matched_id + 1);
+    MEMZERO(matched, char, max_matched_id + 1);
+    for (i = 0; i < n_matched_ids; i++) {
+	matched[matched_ids[i]] = 1;
+    }
+    xfree(matched_ids);
+
+    cursor = grn_table_cursor_open(context, table, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	if (id > max_matched_id || !matched[id])
+	    grn_table_cursor_delete(context, cursor);
+    }
+    grn_table_cursor_close(context, cursor);
+    xfree(matched);
+
+    GRN_OBJ_FIN(context, &score);
+    if (table_score)
+	grn_obj_unlink(context, table_score);
+    if (other_score)
+	grn_obj_unlink(context, other_score);
+}
+
+/*
+ * Same as rb_grn_table_intersect_by_other() but looks up _table_
+ * records in _other_. grn_table_setoperation(GRN_OP_AND) doesn't
+ * add scores of _other_.
+ */
+static void
+rb_grn_table_intersect_by_table (grn_ctx *context,
+				 grn_obj *table, grn_obj *other)
+{
+    grn_table_cursor *cursor;
+    grn_obj *table_score, *other_score;
+    grn_obj score;
+    grn_id id;
+
+    table_score = rb_grn_table_open_score_accessor(context, table);
+    other_score = rb_grn_table_open_score_accessor(context, other);
+    GRN_VOID_INIT(&score);
+
+    cursor = grn_table_cursor_open(context, table, NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	void *key;
+	int key_size;
+	grn_id other_id;
+
+	key_size = grn_table_cursor_get_key(context, cursor, &key);
+	other_id = grn_table_get(context, other, key, key_size);
+	if (other_id == GRN_ID_NIL) {
+	    grn_table_cursor_delete(context, cursor);
+	    continue;
+	}
+
+	if (table_score && other_score) {
+	    int table_score_value, other_score_value;
+
+	    table_score_value = rb_grn_table_get_score(context, table_score,
+						       id, &score);
+	    other_score_value = rb_grn_table_get_score(context, other_score,
+						       other_id, &score);
+	    rb_grn_table_set_score(context, table_score, id,
+				   table_score_value + other_score_value);
+	}
+    }
+    grn_table_cursor_close(context, cursor);
+
+    GRN_OBJ_FIN(context, &score);
+    if (table_score)
+	grn_obj_unlink(context, table_score);
+    if (other_score)
+	grn_obj_unlink(context, other_score);
+}
+
 /*
  * call-seq:
  *   table.intersection!(other) -> Groonga::Table
@@ -1969,11 +4469,188 @@ rb_grn_table_union_bang (VALUE self, VALUE rb_other)
  * キーを比較し、 _other_ には登録されていないレコードを
  * _table_ から削除する。
  *
+ * _other_ にはGroonga::IdBitmapも指定できる。この場合、検索
+ * 結果のテーブルでは元のレコードのID、それ以外のテーブルでは
+ * レコードのIDで比較する。
+ *
+ * _table_ と _other_ がスコアを持つ（検索結果の）場合は
+ * _other_ のスコアを _table_ のスコアに加える。どちらのテー
+ * ブルが小さくても同じスコアになる。
+ *
+ * _other_ の方が小さい場合は _other_ のレコードを _table_ か
+ * ら探すので、大きな検索結果を小さなテーブルで絞り込む場合で
+ * も速い。
  */
 static VALUE
 rb_grn_table_intersection_bang (VALUE self, VALUE rb_other)
 {
-    return rb_grn_table_set_operation_bang(self, rb_other, GRN_OP_AND);
+    grn_ctx *context;
+    grn_obj *table, *other;
+
+    rb_check_frozen(self);
+    if (RVAL2CBOOL(rb_obj_is_kind_of(rb_other, rb_cGrnIdBitmap)))
+	return rb_grn_table_set_operation_bang(self, rb_other, GRN_OP_AND);
+
+    rb_grn_table_deconstruct(SELF(self), &table, &context,
+			     NULL, NULL,
+			     NULL, NULL, NULL,
+			     NULL);
+    rb_grn_table_deconstruct(SELF(rb_other), &other, NULL,
+			     NULL, NULL,
+			     NULL, NULL, NULL,
+			     NULL);
+
+    if (table->header.type == GRN_TABLE_NO_KEY ||
+	other->header.type == GRN_TABLE_NO_KEY)
+	return rb_grn_table_set_operation_bang(self, rb_other, GRN_OP_AND);
+
+    if (grn_table_size(context, other) < grn_table_size(context, table))
+	rb_grn_table_intersect_by_other(context, table, other);
+    else
+	rb_grn_table_intersect_by_table(context, table, other);
+    rb_grn_database_object_modified(table);
+    rb_grn_context_check(context, self);
+
+    return self;
+}
+
+/*
+ * call-seq:
+ *   Groonga::Table.intersect_all(tables, options={}) -> Groonga::Hash
+ *
+ * _tables_ の全てのテーブルに登録されているキーのレコードを
+ * 持つテーブルを返す。 _tables_ は変更しない。
+ *
+ * 小さいテーブルから順に調べるので、最も小さいテーブルのレ
+ * コード数にしか比例しない。スコアを持つテーブル（検索結果）
+ * の場合はスコアの合計が結果のスコアになる。 _tables_ のキー
+ * の型は同じでなければいけない。
+ *
+ * @param options [::Hash] The name and value
+ *   pairs. Omitted names are initialized as the default value.
+ * @option options :result The result
+ *
+ *   結果を格納するテーブル。省略した場合は新しく一時テーブル
+ *   を作る。同じ出力テーブルを使い回したい場合に指定する。指
+ *   定したテーブルの既存のレコードは削除する。
+ *
+ * @example
+ *   visible_entries = Groonga::Table.intersect_all([hits, acl, published])
+ */
+static VALUE
+rb_grn_table_s_intersect_all (int argc, VALUE *argv, VALUE klass)
+{
+    grn_ctx *context = NULL;
+    grn_obj **tables, **scores, *result, *result_score;
+    grn_obj score;
+    grn_table_cursor *cursor;
+    grn_id id;
+    int i, n_tables;
+    VALUE rb_tables, options, rb_result;
+
+    rb_scan_args(argc, argv, "11", &rb_tables, &options);
+    rb_grn_scan_options(options,
+			"result", &rb_result,
+			NULL);
+
+    rb_tables = rb_convert_type(rb_tables, T_ARRAY, "Array", "to_ary");
+    n_tables = RARRAY_LEN(rb_tables);
+    if (n_tables == 0)
+	rb_raise(rb_eArgError, "tables should not be empty");
+
+    tables = ALLOCA_N(grn_obj *, n_tables);
+    scores = ALLOCA_N(grn_obj *, n_tables);
+    for (i = 0; i < n_tables; i++) {
+	VALUE rb_table = RARRAY_PTR(rb_tables)[i];
+
+	if (!RVAL2CBOOL(rb_obj_is_kind_of(rb_table, rb_cGrnTable)))
+	    rb_raise(rb_eArgError, "should be an array of table: <%s>",
+		     rb_grn_inspect(rb_tables));
+	rb_grn_table_deconstruct(SELF(rb_table), &(tables[i]), &context,
+				 NULL, NULL,
+				 NULL, NULL, NULL,
+				 NULL);
+	if (tables[i]->header.type == GRN_TABLE_NO_KEY)
+	    rb_raise(rb_eArgError, "table should have key: <%s>",
+		     rb_grn_inspect(rb_table));
+    }
+
+    /* smaller tables first. */
+    for (i = 1; i < n_tables; i++) {
+	grn_obj *current = tables[i];
+	unsigned int current_size = grn_table_size(context, current);
+	int j = i - 1;
+
+	while (j >= 0 && grn_table_size(context, tables[j]) > current_size) {
+	    tables[j + 1] = tables[j];
+	    j--;
+	}
+	tables[j + 1] = current;
+    }
+    for (i = 0; i < n_tables; i++) {
+	scores[i] = rb_grn_table_open_score_accessor(context, tables[i]);
+    }
+
+    if (NIL_P(rb_result)) {
+	grn_obj *key_type;
+
+	key_type = grn_ctx_at(context, tables[0]->header.domain);
+	result = grn_table_create(context, NULL, 0, NULL,
+				  GRN_TABLE_HASH_KEY | GRN_OBJ_WITH_SUBREC,
+				  key_type, NULL);
+	rb_grn_context_check(context, rb_tables);
+	rb_result = GRNTABLE2RVAL(context, result, GRN_TRUE);
+    } else {
+	grn_rc rc;
+
+	rb_check_frozen(rb_result);
+	result = RVAL2GRNTABLE(rb_result, &context);
+	rc = grn_table_truncate(context, result);
+	rb_grn_database_object_modified(result);
+	rb_grn_context_check(context, rb_result);
+	rb_grn_rc_check(rc, rb_result);
+    }
+    result_score = rb_grn_table_open_score_accessor(context, result);
+
+    GRN_VOID_INIT(&score);
+    cursor = grn_table_cursor_open(context, tables[0], NULL, 0, NULL, 0,
+				   0, -1, GRN_CURSOR_ASCENDING);
+    while ((id = grn_table_cursor_next(context, cursor)) != GRN_ID_NIL) {
+	void *key;
+	int key_size, score_value;
+	grn_id result_id;
+
+	key_size = grn_table_cursor_get_key(context, cursor, &key);
+	score_value = rb_grn_table_get_score(context, scores[0], id, &score);
+	for (i = 1; i < n_tables; i++) {
+	    grn_id table_id;
+
+	    table_id = grn_table_get(context, tables[i], key, key_size);
+	    if (table_id == GRN_ID_NIL)
+		break;
+	    score_value += rb_grn_table_get_score(context, scores[i],
+						  table_id, &score);
+	}
+	if (i < n_tables)
+	    continue;
+
+	result_id = grn_table_add(context, result, key, key_size, NULL);
+	if (result_id != GRN_ID_NIL && result_score)
+	    rb_grn_table_set_score(context, result_score, result_id,
+				   score_value);
+    }
+    grn_table_cursor_close(context, cursor);
+    GRN_OBJ_FIN(context, &score);
+
+    for (i = 0; i < n_tables; i++) {
+	if (scores[i])
+	    grn_obj_unlink(context, scores[i]);
+    }
+    if (result_score)
+	grn_obj_unlink(context, result_score);
+    rb_grn_context_check(context, rb_tables);
+
+    return rb_result;
 }
 
 /*
@@ -1983,6 +4660,8 @@ rb_grn_table_intersection_bang (VALUE self, VALUE rb_other)
  * キーを比較し、 _other_ にも登録されているレコードを _table_
  * から削除する。
  *
+ * _other_ にはGroonga::IdBitmapも指定できる。比較方法は
+ * Groonga::Table#intersection! と同じ。
  */
 static VALUE
 rb_grn_table_difference_bang (VALUE self, VALUE rb_other)
@@ -2091,6 +4770,8 @@ rb_grn_init_table (VALUE mGrn)
 
     rb_define_method(rb_cGrnTable, "size", rb_grn_table_get_size, 0);
     rb_define_method(rb_cGrnTable, "empty?", rb_grn_table_empty_p, 0);
+    rb_define_method(rb_cGrnTable, "to_id_bitmap",
+		     rb_grn_table_to_id_bitmap, 0);
     rb_define_method(rb_cGrnTable, "truncate", rb_grn_table_truncate, 0);
 
     rb_define_method(rb_cGrnTable, "each", rb_grn_table_each, 0);
@@ -2098,6 +4779,7 @@ rb_grn_init_table (VALUE mGrn)
     rb_define_method(rb_cGrnTable, "delete", rb_grn_table_delete, 1);
 
     rb_define_method(rb_cGrnTable, "sort", rb_grn_table_sort, -1);
+    rb_define_method(rb_cGrnTable, "top_k", rb_grn_table_top_k, 2);
     rb_define_method(rb_cGrnTable, "group", rb_grn_table_group, -1);
 
     rb_define_method(rb_cGrnTable, "[]", rb_grn_table_array_reference, 1);
@@ -2118,6 +4800,8 @@ rb_grn_init_table (VALUE mGrn)
     rb_define_method(rb_cGrnTable, "locked?", rb_grn_table_is_locked, -1);
 
     rb_define_method(rb_cGrnTable, "select", rb_grn_table_select, -1);
+    rb_define_method(rb_cGrnTable, "select_each",
+		     rb_grn_table_select_each, -1);
 
     rb_define_method(rb_cGrnTable, "union!", rb_grn_table_union_bang, 1);
     rb_define_method(rb_cGrnTable, "intersection!",
@@ -2126,6 +4810,8 @@ rb_grn_init_table (VALUE mGrn)
 		     rb_grn_table_difference_bang, 1);
     rb_define_method(rb_cGrnTable, "merge!",
 		     rb_grn_table_merge_bang, 1);
+    rb_define_singleton_method(rb_cGrnTable, "intersect_all",
+			       rb_grn_table_s_intersect_all, -1);
 
     rb_define_method(rb_cGrnTable, "support_key?",
 		     rb_grn_table_support_key_p, 0);
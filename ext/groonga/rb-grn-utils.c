@@ -20,6 +20,11 @@
 #include "rb-grn.h"
 
 #include <stdarg.h>
+#ifdef RB_GRN_HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+static ID id_at_id;
 
 const char *
 rb_grn_inspect (VALUE object)
@@ -151,6 +156,28 @@ rb_grn_equal_option (VALUE option, const char *key)
     return GRN_FALSE;
 }
 
+static VALUE
+rb_grn_time_to_ruby_object (int64_t time_value, VALUE related_object)
+{
+    RbGrnTimeFormat format = RB_GRN_TIME_FORMAT_TIME;
+    int64_t sec, usec;
+
+    if (!NIL_P(related_object) &&
+	RVAL2CBOOL(rb_obj_is_kind_of(related_object, rb_cGrnColumn)))
+	format = RB_GRN_COLUMN(DATA_PTR(related_object))->time_format;
+
+    switch (format) {
+      case RB_GRN_TIME_FORMAT_USEC:
+	return LL2NUM(time_value);
+      case RB_GRN_TIME_FORMAT_FLOAT:
+	/* same as Time#to_f: it computes from nanoseconds. */
+	return rb_float_new((double)(time_value * 1000) / 1000000000.0);
+      default:
+	GRN_TIME_UNPACK(time_value, sec, usec);
+	return rb_time_new(sec, usec);
+    }
+}
+
 static VALUE
 rb_grn_bulk_to_ruby_object_by_range_id (grn_ctx *context, grn_obj *bulk,
 					grn_id range_id,
@@ -181,14 +208,8 @@ rb_grn_bulk_to_ruby_object_by_range_id (grn_ctx *context, grn_obj *bulk,
 	*rb_value = rb_float_new(GRN_FLOAT_VALUE(bulk));
 	break;
       case GRN_DB_TIME:
-	{
-	    int64_t time_value, sec, usec;
-
-	    time_value = GRN_TIME_VALUE(bulk);
-	    GRN_TIME_UNPACK(time_value, sec, usec);
-	    *rb_value = rb_funcall(rb_cTime, rb_intern("at"), 2,
-				   LL2NUM(sec), LL2NUM(usec));
-	}
+	*rb_value = rb_grn_time_to_ruby_object(GRN_TIME_VALUE(bulk),
+					       related_object);
 	break;
       case GRN_DB_SHORT_TEXT:
       case GRN_DB_TEXT:
@@ -518,8 +539,92 @@ rb_grn_bulk_from_ruby_object_with_type (VALUE object, grn_ctx *context,
 }
 
 
-VALUE
-rb_grn_vector_to_ruby_object (grn_ctx *context, grn_obj *vector)
+/*
+ * Converts a fixed size value at _element_ to Ruby object without
+ * a temporary bulk. Returns the size of the value or 0 for
+ * unsupported _domain_. _related_object_ is used to choose Time
+ * format like rb_grn_time_to_ruby_object().
+ */
+static unsigned int
+rb_grn_fixed_size_element_to_ruby_object (const char *element, grn_id domain,
+					  VALUE related_object,
+					  VALUE *rb_element)
+{
+    switch (domain) {
+      case GRN_DB_BOOL:
+	*rb_element = *element ? Qtrue : Qfalse;
+	return sizeof(char);
+      case GRN_DB_INT8:
+	*rb_element = INT2NUM(*((int8_t *)element));
+	return sizeof(int8_t);
+      case GRN_DB_UINT8:
+	*rb_element = UINT2NUM(*((uint8_t *)element));
+	return sizeof(uint8_t);
+      case GRN_DB_INT16:
+	{
+	    int16_t value;
+	    memcpy(&value, element, sizeof(value));
+	    *rb_element = INT2NUM(value);
+	    return sizeof(value);
+	}
+      case GRN_DB_UINT16:
+	{
+	    uint16_t value;
+	    memcpy(&value, element, sizeof(value));
+	    *rb_element = UINT2NUM(value);
+	    return sizeof(value);
+	}
+      case GRN_DB_INT32:
+	{
+	    int32_t value;
+	    memcpy(&value, element, sizeof(value));
+	    *rb_element = INT2NUM(value);
+	    return sizeof(value);
+	}
+      case GRN_DB_UINT32:
+	{
+	    uint32_t value;
+	    memcpy(&value, element, sizeof(value));
+	    *rb_element = UINT2NUM(value);
+	    return sizeof(value);
+	}
+      case GRN_DB_INT64:
+	{
+	    int64_t value;
+	    memcpy(&value, element, sizeof(value));
+	    *rb_element = LL2NUM(value);
+	    return sizeof(value);
+	}
+      case GRN_DB_UINT64:
+	{
+	    uint64_t value;
+	    memcpy(&value, element, sizeof(value));
+	    *rb_element = ULL2NUM(value);
+	    return sizeof(value);
+	}
+      case GRN_DB_FLOAT:
+	{
+	    double value;
+	    memcpy(&value, element, sizeof(value));
+	    *rb_element = rb_float_new(value);
+	    return sizeof(value);
+	}
+      case GRN_DB_TIME:
+	{
+	    int64_t value;
+	    memcpy(&value, element, sizeof(value));
+	    *rb_element = rb_grn_time_to_ruby_object(value,
+							     related_object);
+	    return sizeof(value);
+	}
+      default:
+	return 0;
+    }
+}
+
+static VALUE
+rb_grn_vector_to_ruby_object_raw (grn_ctx *context, grn_obj *vector,
+				  VALUE related_object, grn_bool with_weight)
 {
     VALUE array;
     grn_obj value;
@@ -535,19 +640,51 @@ rb_grn_vector_to_ruby_object (grn_ctx *context, grn_obj *vector)
 	const char *_value;
 	unsigned int weight, length;
 	grn_id domain;
+	VALUE rb_element;
 
 	length = grn_vector_get_element(context, vector, i,
 					&_value, &weight, &domain);
-	grn_obj_reinit(context, &value, domain, 0);
-	grn_bulk_write(context, &value, _value, length);
-	rb_ary_push(array, GRNOBJ2RVAL(Qnil, context, &value, Qnil));
-	/* UINT2NUM(weight); */ /* TODO: How handle weight? */
+	switch (domain) {
+	  case GRN_DB_SHORT_TEXT:
+	  case GRN_DB_TEXT:
+	  case GRN_DB_LONG_TEXT:
+	    rb_element = rb_grn_context_rb_string_new(context, _value, length);
+	    break;
+	  default:
+	    if (rb_grn_fixed_size_element_to_ruby_object(_value, domain,
+							 related_object,
+							 &rb_element) !=
+		length) {
+		grn_obj_reinit(context, &value, domain, 0);
+		grn_bulk_write(context, &value, _value, length);
+		rb_element = GRNOBJ2RVAL(Qnil, context, &value,
+					 related_object);
+	    }
+	    break;
+	}
+	if (with_weight)
+	    rb_element = rb_assoc_new(rb_element, UINT2NUM(weight));
+	rb_ary_push(array, rb_element);
     }
     GRN_OBJ_FIN(context, &value);
 
     return array;
 }
 
+VALUE
+rb_grn_vector_to_ruby_object (grn_ctx *context, grn_obj *vector)
+{
+    return rb_grn_vector_to_ruby_object_raw(context, vector, Qnil, GRN_FALSE);
+}
+
+VALUE
+rb_grn_vector_to_ruby_object_with_weight (grn_ctx *context, grn_obj *vector,
+					  VALUE related_object)
+{
+    return rb_grn_vector_to_ruby_object_raw(context, vector, related_object,
+					    GRN_TRUE);
+}
+
 grn_obj *
 rb_grn_vector_from_ruby_object (VALUE object, grn_ctx *context, grn_obj *vector)
 {
@@ -612,6 +749,7 @@ rb_grn_uvector_from_ruby_object (VALUE object, grn_ctx *context,
 
     n = RARRAY_LEN(object);
     values = RARRAY_PTR(object);
+    grn_bulk_reserve(context, uvector, sizeof(grn_id) * n);
     for (i = 0; i < n; i++) {
 	VALUE value;
 	grn_id id;
@@ -623,7 +761,10 @@ rb_grn_uvector_from_ruby_object (VALUE object, grn_ctx *context,
 	    id = NUM2UINT(value);
 	    break;
 	  default:
-	    if (rb_respond_to(value, rb_intern("record_raw_id"))) {
+	    if (CLASS_OF(value) == rb_cGrnRecord) {
+		/* Groonga::Record#record_raw_id just returns @id. */
+		id = NUM2UINT(rb_ivar_get(value, id_at_id));
+	    } else if (rb_respond_to(value, rb_intern("record_raw_id"))) {
 		id = NUM2UINT(rb_funcall(value, rb_intern("record_raw_id"), 0));
 	    } else {
 		grn_obj_unlink(context, uvector);
@@ -665,7 +806,34 @@ rb_grn_value_to_ruby_object (grn_ctx *context,
 	return GRNBULK2RVAL(context, value, range, related_object);
 	break;
       case GRN_UVECTOR:
-	{
+	if (range && range->header.type == GRN_TYPE) {
+	    VALUE rb_value;
+	    const char *current, *end;
+	    grn_id range_id;
+
+	    range_id = grn_obj_id(context, range);
+	    rb_value = rb_ary_new();
+	    current = GRN_BULK_HEAD(value);
+	    end = GRN_BULK_CURR(value);
+	    while (current < end) {
+		VALUE rb_element;
+		unsigned int size;
+
+		size = rb_grn_fixed_size_element_to_ruby_object(current,
+								range_id,
+								related_object,
+								&rb_element);
+		if (size == 0)
+		    rb_raise(rb_eGrnError,
+			     "unsupported uvector element type: %s: %s",
+			     rb_grn_inspect(GRNOBJECT2RVAL(Qnil, context,
+							   range, GRN_FALSE)),
+			     rb_grn_inspect(related_object));
+		rb_ary_push(rb_value, rb_element);
+		current += size;
+	    }
+	    return rb_value;
+	} else {
 	    VALUE rb_value, rb_range = Qnil;
 	    grn_id *uvector, *uvector_end;
 
@@ -853,7 +1021,49 @@ rb_grn_obj_to_ruby_object (VALUE klass, grn_ctx *context,
     return Qnil;
 }
 
+/*
+ * Runs _worker_ with each of _n_workers_ elements of _data_ that
+ * are _data_size_ bytes each. Workers run on native threads if
+ * available, sequentially otherwise. Workers must not call Ruby
+ * API. Callers must cap _n_workers_ by RB_GRN_MAX_WORKERS before
+ * they split their work.
+ */
+void
+rb_grn_run_workers (void *(*worker) (void *data),
+		    void *data, size_t data_size, int n_workers)
+{
+    char *worker_data = data;
+    int i;
+#ifdef RB_GRN_HAVE_PTHREAD
+    pthread_t *threads;
+    int n_threads = 0;
+
+    if (n_workers > 1) {
+	threads = ALLOCA_N(pthread_t, n_workers - 1);
+	for (i = 1; i < n_workers; i++) {
+	    void *current_data = worker_data + data_size * i;
+	    if (pthread_create(&(threads[n_threads]), NULL,
+			       worker, current_data) == 0) {
+		n_threads++;
+	    } else {
+		worker(current_data);
+	    }
+	}
+    }
+    if (n_workers > 0)
+	worker(worker_data);
+    for (i = 0; i < n_threads; i++) {
+	pthread_join(threads[i], NULL);
+    }
+#else
+    for (i = 0; i < n_workers; i++) {
+	worker(worker_data + data_size * i);
+    }
+#endif
+}
+
 void
 rb_grn_init_utils (VALUE mGrn)
 {
+    id_at_id = rb_intern("@id");
 }
@@ -18,6 +18,10 @@
 
 #include "rb-grn.h"
 
+#ifdef HAVE_RUBY_THREAD_H
+#  include <ruby/thread.h>
+#endif
+
 #define SELF(object) ((RbGrnColumn *)DATA_PTR(object))
 
 VALUE rb_cGrnVariableSizeColumn;
@@ -28,6 +32,67 @@ VALUE rb_cGrnVariableSizeColumn;
  * 可変長データ用のカラム。
  */
 
+typedef struct _RbGrnDefragData RbGrnDefragData;
+struct _RbGrnDefragData
+{
+    grn_ctx *context;
+    grn_obj *object;
+    int threshold;
+    int n_segments;
+};
+
+static void *
+rb_grn_defrag_without_gvl (void *user_data)
+{
+    RbGrnDefragData *data = user_data;
+
+    data->n_segments = grn_obj_defrag(data->context, data->object,
+				      data->threshold);
+    return NULL;
+}
+
+#if !defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL) && \
+    defined(HAVE_RB_THREAD_BLOCKING_REGION)
+static VALUE
+rb_grn_defrag_blocking_region (void *user_data)
+{
+    rb_grn_defrag_without_gvl(user_data);
+    return Qnil;
+}
+#endif
+
+/*
+ * Runs grn_obj_defrag(). If _without_gvl_ is true, GVL is released
+ * while defragging so that other Ruby threads can run. _context_
+ * must not be used by other threads in the meantime.
+ */
+int
+rb_grn_variable_size_column_defrag_raw (grn_ctx *context, grn_obj *object,
+					int threshold, grn_bool without_gvl)
+{
+    RbGrnDefragData data;
+
+    data.context = context;
+    data.object = object;
+    data.threshold = threshold;
+    data.n_segments = 0;
+    if (without_gvl) {
+#if defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL)
+	rb_thread_call_without_gvl(rb_grn_defrag_without_gvl, &data,
+				   NULL, NULL);
+#elif defined(HAVE_RB_THREAD_BLOCKING_REGION)
+	rb_thread_blocking_region(rb_grn_defrag_blocking_region, &data,
+				  NULL, NULL);
+#else
+	rb_grn_defrag_without_gvl(&data);
+#endif
+    } else {
+	rb_grn_defrag_without_gvl(&data);
+    }
+
+    return data.n_segments;
+}
+
 /*
  * Document-method: defrag
  *
@@ -41,6 +106,13 @@ VALUE rb_cGrnVariableSizeColumn;
  *   determine whether a segment is defraged. Available
  *   values are -4..22. -4 means all segments are defraged.
  *   22 means no segment is defraged.
+ * @option options [Boolean] :without_gvl (false) releases GVL
+ *   while defragging so that other Ruby threads can run. The
+ *   context of the column must not be used by other threads
+ *   until it returns. It raises ArgumentError while
+ *   Groonga::Logger that isn't buffered is registered because
+ *   the logger calls Ruby from groonga's log function. It is
+ *   ignored on Ruby 1.8.
  * @since 1.2.6
  */
 static VALUE
@@ -50,22 +122,26 @@ rb_grn_variable_size_column_defrag (int argc, VALUE *argv, VALUE self)
     grn_ctx *context = NULL;
     grn_obj *column;
     int n_segments;
-    VALUE options, rb_threshold;
+    VALUE options, rb_threshold, rb_without_gvl;
     int threshold = 0;
 
     rb_scan_args(argc, argv, "01", &options);
     rb_grn_scan_options(options,
 			"threshold", &rb_threshold,
+			"without_gvl", &rb_without_gvl,
 			NULL);
     if (!NIL_P(rb_threshold)) {
 	threshold = NUM2INT(rb_threshold);
     }
+    if (RVAL2CBOOL(rb_without_gvl))
+	rb_grn_logger_check_without_gvl();
 
     rb_grn_column = SELF(self);
     rb_grn_object_deconstruct(RB_GRN_OBJECT(rb_grn_column), &column, &context,
 			      NULL, NULL,
 			      NULL, NULL);
-    n_segments = grn_obj_defrag(context, column, threshold);
+    n_segments = rb_grn_variable_size_column_defrag_raw(
+	context, column, threshold, RVAL2CBOOL(rb_without_gvl));
     rb_grn_context_check(context, self);
 
     return INT2NUM(n_segments);
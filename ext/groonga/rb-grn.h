@@ -75,6 +75,7 @@ RB_GRN_BEGIN_DECLS
 #define RB_GRN_MICRO_VERSION 9
 
 #define RB_GRN_QUERY_DEFAULT_MAX_EXPRESSIONS 32
+#define RB_GRN_MAX_WORKERS 64
 
 #include <stdint.h>
 
@@ -137,11 +138,18 @@ struct _RbGrnTableKeySupport
     grn_obj *key;
 };
 
+typedef enum {
+    RB_GRN_TIME_FORMAT_TIME,
+    RB_GRN_TIME_FORMAT_USEC,
+    RB_GRN_TIME_FORMAT_FLOAT
+} RbGrnTimeFormat;
+
 typedef struct _RbGrnColumn RbGrnColumn;
 struct _RbGrnColumn
 {
     RbGrnNamedObject parent;
     grn_obj *value;
+    RbGrnTimeFormat time_format;
 };
 
 typedef struct _RbGrnIndexColumn RbGrnIndexColumn;
@@ -193,6 +201,8 @@ struct _RbGrnPlugin
     grn_id id;
 };
 
+typedef grn_bool (*RbGrnIdBitmapEachFunction) (grn_id id, void *user_data);
+
 RB_GRN_VAR grn_bool rb_grn_exited;
 
 RB_GRN_VAR VALUE rb_eGrnError;
@@ -234,6 +244,7 @@ RB_GRN_VAR VALUE rb_cGrnExpression;
 RB_GRN_VAR VALUE rb_cGrnRecordExpressionBuilder;
 RB_GRN_VAR VALUE rb_cGrnColumnExpressionBuilder;
 RB_GRN_VAR VALUE rb_cGrnPlugin;
+RB_GRN_VAR VALUE rb_cGrnIdBitmap;
 
 void           rb_grn_init_utils                    (VALUE mGrn);
 void           rb_grn_init_exception                (VALUE mGrn);
@@ -274,6 +285,7 @@ void           rb_grn_init_expression_builder       (VALUE mGrn);
 void           rb_grn_init_logger                   (VALUE mGrn);
 void           rb_grn_init_snippet                  (VALUE mGrn);
 void           rb_grn_init_plugin                   (VALUE mGrn);
+void           rb_grn_init_id_bitmap                (VALUE mGrn);
 
 VALUE          rb_grn_rc_to_exception               (grn_rc rc);
 const char    *rb_grn_rc_to_message                 (grn_rc rc);
@@ -298,6 +310,10 @@ void           rb_grn_scan_options                  (VALUE options, ...)
                                                      RB_GRN_GNUC_NULL_TERMINATED;
 grn_bool       rb_grn_equal_option                  (VALUE option,
 						     const char *key);
+void           rb_grn_run_workers                   (void *(*worker) (void *data),
+						     void *data,
+						     size_t data_size,
+						     int n_workers);
 
 VALUE          rb_grn_object_alloc                  (VALUE klass);
 void           rb_grn_object_bind                   (VALUE self,
@@ -390,6 +406,14 @@ VALUE          rb_grn_table_get_column_value_raw    (VALUE self,
 VALUE          rb_grn_table_get_column_value        (VALUE self,
 						     VALUE rb_id,
 						     VALUE rb_name);
+VALUE          rb_grn_table_get_column_value_with_options
+                                                    (VALUE self,
+						     grn_id id,
+						     VALUE rb_name,
+						     VALUE rb_options);
+grn_bool       rb_grn_table_select_may_update_p     (VALUE rb_condition,
+						     VALUE rb_syntax,
+						     VALUE rb_allow_update);
 VALUE          rb_grn_table_set_column_value_raw    (VALUE self,
 						     grn_id id,
 						     VALUE rb_name,
@@ -439,6 +463,18 @@ void           rb_grn_column_deconstruct            (RbGrnColumn *rb_grn_column,
 						     grn_obj **value,
 						     grn_id *range_id,
 						     grn_obj **range);
+VALUE          rb_grn_column_get_ids                (VALUE self,
+						     grn_id id);
+VALUE          rb_grn_column_get_packed             (VALUE self,
+						     grn_id id);
+VALUE          rb_grn_column_get_with_weight        (VALUE self,
+						     grn_id id);
+
+int            rb_grn_variable_size_column_defrag_raw
+                                                    (grn_ctx *context,
+						     grn_obj *object,
+						     int threshold,
+						     grn_bool without_gvl);
 
 void           rb_grn_index_column_bind             (RbGrnIndexColumn *rb_grn_index_column,
 						     grn_ctx *context,
@@ -485,6 +521,17 @@ VALUE          rb_grn_record_new_raw                (VALUE table,
 						     VALUE id,
 						     VALUE values);
 
+VALUE          rb_grn_id_bitmap_new                 (void);
+VALUE          rb_grn_id_bitmap_new_from_table      (grn_ctx *context,
+						     grn_obj *table);
+void           rb_grn_id_bitmap_add                 (VALUE self,
+						     grn_id id);
+grn_bool       rb_grn_id_bitmap_include             (VALUE self,
+						     grn_id id);
+void           rb_grn_id_bitmap_each_raw            (VALUE self,
+						     RbGrnIdBitmapEachFunction function,
+						     void *user_data);
+
 VALUE          rb_grn_view_record_new               (VALUE    view,
 						     grn_obj *id);
 VALUE          rb_grn_view_record_new_raw           (VALUE view,
@@ -624,6 +671,13 @@ VALUE          rb_grn_object_to_ruby_object         (VALUE klass,
 						     grn_bool owner);
 VALUE          rb_grn_object_to_ruby_class          (grn_obj *object);
 
+void           rb_grn_database_modified             (void);
+void           rb_grn_database_object_modified      (grn_obj *object);
+unsigned long  rb_grn_database_modification_count   (void);
+void           rb_grn_database_schema_modified      (void);
+unsigned long  rb_grn_database_schema_modification_count
+                                                    (void);
+
 grn_obj       *rb_grn_database_from_ruby_object     (VALUE object);
 VALUE          rb_grn_database_to_ruby_object       (grn_ctx *context,
 						     grn_obj *db,
@@ -669,6 +723,8 @@ grn_operator   rb_grn_operator_from_ruby_object     (VALUE object);
 
 grn_logger_info *
                rb_grn_logger_from_ruby_object       (VALUE object);
+grn_bool       rb_grn_logger_call_ruby_p            (void);
+void           rb_grn_logger_check_without_gvl      (void);
 
 grn_obj       *rb_grn_bulk_from_ruby_object         (VALUE object,
 						     grn_ctx *context,
@@ -688,6 +744,10 @@ grn_obj       *rb_grn_vector_from_ruby_object       (VALUE object,
 						     grn_obj *vector);
 VALUE          rb_grn_vector_to_ruby_object         (grn_ctx *context,
 						     grn_obj *vector);
+VALUE          rb_grn_vector_to_ruby_object_with_weight
+                                                    (grn_ctx *context,
+						     grn_obj *vector,
+						     VALUE related_object);
 grn_obj       *rb_grn_uvector_from_ruby_object      (VALUE object,
 						     grn_ctx *context,
 						     grn_obj *uvector,
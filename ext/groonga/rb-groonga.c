@@ -146,4 +146,5 @@ Init_groonga (void)
     rb_grn_init_logger(mGrn);
     rb_grn_init_snippet(mGrn);
     rb_grn_init_plugin(mGrn);
+    rb_grn_init_id_bitmap(mGrn);
 }
@@ -91,5 +91,7 @@ require 'groonga/patricia-trie'
 require 'groonga/dumper'
 require 'groonga/schema'
 require 'groonga/pagination'
+require 'groonga/drilldown'
+require 'groonga/prepared-select'
 require 'groonga/query-log'
 require 'groonga/grntest-log'
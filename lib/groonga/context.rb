@@ -76,6 +76,66 @@ module Groonga
       select.exec
     end
 
+    # _commands_ をまとめて実行し、実行結果の文字列を _commands_
+    # と同じ順番で並べた配列を返す。ブロックを指定した場合はコマ
+    # ンドと実行結果を受信した順にブロックに渡す。
+    #
+    # _commands_ の要素はコマンド文字列か
+    # Groonga::QueryLog::Commandのように +to_command_format+ に応
+    # 答するオブジェクト。
+    #
+    # groongaサーバに接続している場合は _:window_ 個のコマンドを
+    # 続けて送信してから結果をまとめて受信するので、サーバとの
+    # 往復の回数が少なくなる。
+    #
+    # エラーが発生した場合はそれ以降のコマンドは送信せずに例外
+    # を発生させる。送信済みのコマンドの結果は読み捨てるので、
+    # 例外が発生した後もそのままコンテキストを使える。ただし、
+    # _:window_ に2以上を指定した場合は、エラーになったコマン
+    # ドと同じ _:window_ 内の後続のコマンドは既に送信済みなので
+    # サーバー上で実行される。
+    #
+    # @param [::Hash] options The name and value
+    #   pairs. Omitted names are initialized as the default value.
+    # @option options [Integer] :window (100) The window
+    #
+    #   groongaサーバに接続しているときに、結果を受信する前に
+    #   続けて送信するコマンドの最大数。エラーになったときに後
+    #   続のコマンドを実行したくない場合は1を指定する。ローカル
+    #   のデータベースを使っている場合は常に1。
+    def execute_batch(commands, options={})
+      window = options[:window] || 100
+      window = 1 unless connected?
+      if window < 1
+        raise ArgumentError, "window should be 1 or larger: <#{window}>"
+      end
+
+      results = []
+      commands.each_slice(window) do |sliced_commands|
+        # GQTPではクエリIDは常に0なので、IDではなく受信していな
+        # い結果の数で対応をとる。
+        n_pending_responses = 0
+        begin
+          sliced_commands.each do |command|
+            if command.respond_to?(:to_command_format)
+              command = command.to_command_format
+            end
+            send(command)
+            n_pending_responses += 1
+          end
+          sliced_commands.each do |command|
+            n_pending_responses -= 1
+            _, result = receive
+            results << result
+            yield(command, result) if block_given?
+          end
+        ensure
+          discard_responses(n_pending_responses)
+        end
+      end
+      results
+    end
+
     class SelectResult < Struct.new(:n_hits, :columns, :values,
                                     :drill_down)
       class << self
@@ -94,15 +154,7 @@ module Groonga
         end
 
         def create_records(columns, values)
-          records = []
-          values.each do |value|
-            record = {}
-            columns.each_with_index do |(name, type), i|
-              record[name] = convert_value(value[i], type)
-            end
-            records << record
-          end
-          records
+          Records.new(columns, values)
         end
 
         private
@@ -125,14 +177,6 @@ module Groonga
           [n_hits, columns, values]
         end
 
-        def convert_value(value, type)
-          case type
-          when "Time"
-            Time.at(value)
-          else
-            value
-          end
-        end
       end
 
       def records
@@ -144,6 +188,124 @@ module Groonga
           @records ||= SelectResult.create_records(columns, values)
         end
       end
+
+      # 検索結果のレコード列。各レコードは必要になるまでHashを
+      # 作らず、パース済みの配列から直接値を取り出す。値はカラム
+      # の型に応じて変換される。
+      class Records
+        include Enumerable
+
+        def initialize(columns, values)
+          @columns = columns
+          @values = values
+          @column_indexes = {}
+          @converters = []
+          @columns.each_with_index do |(name, type), i|
+            @column_indexes[name] = i
+            @converters << converter(type)
+          end
+          @records = []
+        end
+
+        def size
+          @values.size
+        end
+        alias_method :length, :size
+
+        def empty?
+          @values.empty?
+        end
+
+        def column_names
+          @columns.collect {|name, type| name}
+        end
+
+        # Array#[]と同じように _index_ 番目のレコードをHashとし
+        # て返す。Rangeや開始位置と長さを指定するとレコードの配列
+        # を返す。Hashは最初にアクセスしたときに作られる。
+        def [](*arguments)
+          if arguments.size == 1 and arguments[0].is_a?(Integer)
+            return record_at(arguments[0])
+          end
+          indexes = (0...size).to_a[*arguments]
+          return nil if indexes.nil?
+          indexes.collect {|index| record_at(index)}
+        end
+        alias_method :slice, :[]
+
+        def last(n=nil)
+          return self[-1] if n.nil?
+          raise ArgumentError, "negative array size: <#{n}>" if n < 0
+          start = [size - n, 0].max
+          self[start, size - start]
+        end
+
+        def each
+          return to_enum(:each) unless block_given?
+          size.times do |i|
+            yield(self[i])
+          end
+        end
+
+        # _name_ カラムの値だけを配列で返す。レコードごとのHash
+        # は作らない。
+        def pluck(name)
+          i = @column_indexes[name.to_s]
+          if i.nil?
+            raise ArgumentError, "unknown column: <#{name.inspect}>: " +
+                                 "available: <#{column_names.inspect}>"
+          end
+          converter = @converters[i]
+          if converter
+            @values.collect {|value| converter.call(value[i])}
+          else
+            @values.collect {|value| value[i]}
+          end
+        end
+
+        def to_a
+          collect {|record| record}
+        end
+        alias_method :to_ary, :to_a
+
+        def ==(other)
+          other.respond_to?(:to_ary) and to_a == other.to_ary
+        end
+
+        def inspect
+          to_a.inspect
+        end
+
+        private
+        def record_at(index)
+          value = @values[index]
+          return nil if value.nil?
+          index += size if index < 0
+          @records[index] ||= create_record(value)
+        end
+
+        def create_record(value)
+          record = {}
+          @columns.each_with_index do |(name, type), i|
+            converter = @converters[i]
+            if converter
+              record[name] = converter.call(value[i])
+            else
+              record[name] = value[i]
+            end
+          end
+          record
+        end
+
+        def converter(type)
+          case type
+          when "Time"
+            Proc.new {|value| Time.at(value)}
+          else
+            nil
+          end
+        end
+      end
     end
 
     class SelectCommand
@@ -197,5 +359,15 @@ module Groonga
         _query
       end
     end
+
+    private
+    def discard_responses(n_responses)
+      n_responses.times do
+        begin
+          receive
+        rescue Groonga::Error
+        end
+      end
+    end
   end
 end
@@ -0,0 +1,68 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2011  Kouhei Sutou <kou@clear-code.com>
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1 as published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+module Groonga
+  class Table
+    # ドリルダウン用便利メソッド。複数のキーでそれぞれ独立に
+    # グループ化し、キーごとにソート済みの上位のグループを返す。
+    # 検索結果のファセットを表示したい場合は #group を複数回呼
+    # ぶよりも #drilldown の方が便利で速い。レコードの走査は
+    # キーの数によらず1回だけである。
+    #
+    #   entries = Groonga["entries"].select do |record|
+    #     record.description =~ "Ruby"
+    #   end
+    #   drilldowns = entries.drilldown(["tag", "author"], :limit => 5)
+    #   drilldowns["tag"].each do |tag|
+    #     puts "#{tag.key}: #{tag.n_sub_records}"
+    #   end
+    #
+    # 返り値はキーをキーにしたHash。値はグループ化した結果の
+    # レコードをソートした配列。 +:aggregate+ を指定した場合は
+    # 各レコードの #table の +aggregates+ で集計結果を取得できる。
+    #
+    # _options_ に指定可能な値は以下の通り。
+    #
+    # @param [::Hash] options The name and value
+    #   pairs. Omitted names are initialized as the default value.
+    # @option options [Integer] :limit (10) The limit
+    #
+    #   キーごとに返すグループの最大数。
+    # @option options :sort_keys ([["_nsubrecs", :desc]]) The sort keys
+    #
+    #   グループのソート順。指定の仕方は #sort と同様。
+    # @option options [::Hash] :aggregate The aggregate
+    #
+    #   グループごとに集計するカラム。指定の仕方は #group と同様。
+    def drilldown(keys, options={})
+      keys = [keys] unless keys.is_a?(::Array)
+      return {} if keys.empty?
+      limit = options[:limit] || 10
+      sort_keys = options[:sort_keys] || [["_nsubrecs", :desc]]
+      group_options = {}
+      group_options[:aggregate] = options[:aggregate] if options[:aggregate]
+      results = group(keys, group_options)
+      results = [results] if keys.size == 1
+
+      drilldowns = {}
+      keys.each_with_index do |key, i|
+        drilldowns[key] = results[i].sort(sort_keys, :limit => limit)
+      end
+      drilldowns
+    end
+  end
+end
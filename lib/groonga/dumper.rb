@@ -477,12 +477,28 @@ module Groonga
     end
 
     def dump_records(columns)
-      @table.each do |record|
-        write(",\n")
-        values = columns.collect do |column|
-          resolve_value(column[record.id])
+      time_columns = columns.select do |column|
+        column.is_a?(Groonga::Column) and column.range.is_a?(Groonga::Type) and
+          column.range.id == Groonga::Type::TIME
+      end
+      time_formats = time_columns.collect do |column|
+        column.time_format
+      end
+      begin
+        time_columns.each do |column|
+          column.time_format = :float
+        end
+        @table.each do |record|
+          write(",\n")
+          values = columns.collect do |column|
+            resolve_value(column[record.id])
+          end
+          write(values.to_json)
+        end
+      ensure
+        time_columns.zip(time_formats) do |column, time_format|
+          column.time_format = time_format
         end
-        write(values.to_json)
       end
     end
 
@@ -37,6 +37,7 @@ module Groonga
       @allow_column = nil
       @allow_update = nil
       @default_column = nil
+      @parameters = {}
     end
 
     def build(&block)
@@ -53,6 +54,25 @@ module Groonga
       other
     end
 
+    # 値を後から設定できる定数を返す。定数の代わりに使うと、
+    # 式を組み立て直さずに値だけを変えて何度も検索できる。
+    # 値は #parameters で取得できる変数に設定する。
+    #
+    # 参考: Groonga::Table#prepare_select
+    def param(name)
+      @parameters[name.to_sym] ||= ParameterExpressionBuilder.new(name)
+    end
+
+    # #param で作った変数を名前をキーにしたHashで返す。 #build
+    # した後でないと空のHash。
+    def parameters
+      variables = {}
+      @parameters.each do |name, builder|
+        variables[name] = builder.variable if builder.variable
+      end
+      variables
+    end
+
     private
     def default_parse_options
       {
@@ -298,11 +318,30 @@ module Groonga
 
       def build(expression, variable)
         @column_value_builder.build(expression, variable)
-        expression.append_constant(@value)
+        if @value.is_a?(ParameterExpressionBuilder)
+          @value.build(expression, variable)
+        else
+          expression.append_constant(@value)
+        end
         expression.append_operation(@operation, 2)
       end
     end
 
+    # @private
+    class ParameterExpressionBuilder < ExpressionBuilder
+      attr_reader :name, :variable
+      def initialize(name)
+        super()
+        @name = name.to_sym
+        @variable = nil
+      end
+
+      def build(expression, variable)
+        @variable ||= expression.define_variable(:name => @name.to_s)
+        expression.append_object(@variable)
+      end
+    end
+
     # @private
     class EqualExpressionBuilder < BinaryExpressionBuilder
       def initialize(column_value_builder, value)
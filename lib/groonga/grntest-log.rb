@@ -19,6 +19,7 @@ require "English"
 require "time"
 
 require "groonga/json"
+require "groonga/query-log"
 
 module Groonga
   module GrntestLog
@@ -157,6 +158,130 @@ module Groonga
       end
     end
 
+    # grntestのログをイベント毎に保持せずに集計する。コマンド
+    # 名毎に実行時間の分布( Groonga::QueryLog::LatencyHistogram )
+    # と最初に開始した時刻、最後に終了した時刻だけを保持するの
+    # で、ログが大きくてもメモリー使用量は一定になる。
+    class Summarizer
+      def initialize
+        @parser = Parser.new
+      end
+
+      # @return [Summary] _input_ の集計結果。
+      def summarize(input)
+        summary = Summary.new
+        @parser.parse(input) do |event|
+          summary << event if event.is_a?(TaskEvent)
+        end
+        summary
+      end
+    end
+
+    class Summary
+      class CommandSummary
+        attr_reader :name, :histogram, :start_time, :end_time
+        def initialize(name)
+          @name = name
+          @histogram = QueryLog::LatencyHistogram.new
+          @start_time = nil
+          @end_time = nil
+        end
+
+        def add(event)
+          # grntestはマイクロ秒で記録する。
+          @histogram << event.elapsed_time * 1000
+          if @start_time.nil? or event.relative_start_time < @start_time
+            @start_time = event.relative_start_time
+          end
+          if @end_time.nil? or event.relative_end_time > @end_time
+            @end_time = event.relative_end_time
+          end
+        end
+
+        def n_queries
+          @histogram.count
+        end
+
+        # @return [Float] 1秒あたりに実行したクエリ数。
+        def qps
+          duration = (@end_time - @start_time) / 1_000_000.0
+          return nil if duration <= 0
+          n_queries / duration
+        end
+
+        # @return [Integer] _percent_ %の実行時間(ナノ秒)。
+        def percentile(percent)
+          @histogram.percentile(percent)
+        end
+      end
+
+      Regression = Struct.new(:command_name, :metric, :base, :current)
+
+      attr_reader :commands
+      def initialize
+        @commands = {}
+      end
+
+      def add(event)
+        name = QueryLog::Command.extract_name(event.command)
+        command = (@commands[name] ||= CommandSummary.new(name))
+        command.add(event)
+        self
+      end
+      alias_method :<<, :add
+
+      def n_queries
+        @commands.values.inject(0) do |total, command|
+          total + command.n_queries
+        end
+      end
+
+      # _base_ と比較して悪くなった指標を返す。実行時間の
+      # パーセンタイルが _:threshold_ の割合以上長くなったか、
+      # qpsが _:threshold_ の割合以上下がったものを悪くなったと
+      # みなす。
+      #
+      # @param [::Hash] options The name and value
+      #   pairs. Omitted names are initialized as the default value.
+      # @option options [Float] :threshold (0.1)
+      #   パーセンタイルの誤差と区別できるように
+      #   QueryLog::LatencyHistogram::RESOLUTION より大きな値を
+      #   指定する。
+      # @option options [::Array] :percentiles ([50, 90, 99])
+      # @return [::Array] Regression の配列。
+      def compare(base, options={})
+        threshold = options[:threshold] || 0.1
+        resolution = QueryLog::LatencyHistogram::RESOLUTION
+        if threshold <= resolution
+          raise ArgumentError,
+                "threshold should be larger than the resolution of " +
+                "latency histogram: <#{resolution}>: <#{threshold}>"
+        end
+        percentiles = options[:percentiles] || [50, 90, 99]
+        regressions = []
+        @commands.keys.sort.each do |name|
+          command = @commands[name]
+          base_command = base.commands[name]
+          next if base_command.nil?
+          percentiles.each do |percent|
+            base_value = base_command.percentile(percent)
+            current_value = command.percentile(percent)
+            if current_value > base_value * (1 + threshold)
+              regressions << Regression.new(name, "#{percent}%",
+                                            base_value, current_value)
+            end
+          end
+          base_qps = base_command.qps
+          current_qps = command.qps
+          if base_qps and current_qps and
+              current_qps < base_qps * (1 - threshold)
+            regressions << Regression.new(name, "qps", base_qps, current_qps)
+          end
+        end
+        regressions
+      end
+    end
+
     class Parser
       def initialize
       end
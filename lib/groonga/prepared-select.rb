@@ -0,0 +1,107 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2011  Kouhei Sutou <kou@clear-code.com>
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1 as published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+module Groonga
+  class Table
+    # 検索条件を一度だけ組み立て、値だけを変えて何度も検索で
+    # きるGroonga::PreparedSelectを返す。条件の指定方法は
+    # #select と同じだが、定数の代わりに +param(name)+ を使え
+    # る。 +param+ の値はGroonga::PreparedSelect#executeで指定
+    # する。
+    #
+    # ブロックには #select と同じようにレコードの条件を組み立
+    # てるオブジェクトが渡されるので、 +record.param(name)+ の
+    # ように呼ぶ。
+    #
+    # @example
+    #   cheap_items = items.prepare_select do |record|
+    #     record.price < record.param(:max)
+    #   end
+    #   cheap_items.execute(:max => 100)
+    #   cheap_items.execute(:max => 500)
+    #
+    # @param [::Hash] options The name and value
+    #   pairs. Omitted names are initialized as the default value.
+    # @option options :name The name
+    #
+    #   条件の名前。省略した場合は名前を付けない。
+    def prepare_select(query=nil, options={}, &block)
+      if query.is_a?(::Hash)
+        options = query
+        query = nil
+      end
+      builder = RecordExpressionBuilder.new(self, options[:name])
+      builder.query = query
+      builder.syntax = options[:syntax]
+      builder.allow_pragma = options[:allow_pragma]
+      builder.allow_column = options[:allow_column]
+      builder.allow_update = options[:allow_update]
+      builder.default_column = options[:default_column]
+      expression = builder.build(&block)
+      PreparedSelect.new(self, expression, builder.parameters)
+    end
+  end
+
+  # Groonga::Table#prepare_selectで組み立てた検索条件。
+  # #execute するたびに +param+ の値だけを設定し直して検索す
+  # る。
+  class PreparedSelect
+    # 検索対象のテーブル。
+    attr_reader :table
+    # 組み立て済みのGroonga::Expression。
+    attr_reader :expression
+    def initialize(table, expression, parameters)
+      @table = table
+      @expression = expression
+      @parameters = parameters
+    end
+
+    # +param+ の名前の配列を返す。
+    def parameter_names
+      @parameters.keys
+    end
+
+    # _values_ で +param+ の値を設定して検索する。全ての
+    # +param+ の値を指定しなければいけない。参照カラムと比較す
+    # る +param+ にはGroonga::Recordを指定する。 _options_ は
+    # Groonga::Table#selectと同じ。
+    def execute(values={}, options={})
+      bind(values)
+      @table.select(@expression, options)
+    end
+
+    private
+    def bind(values)
+      normalized_values = {}
+      values.each do |name, value|
+        normalized_values[name.to_sym] = value
+      end
+      unknown_names = normalized_values.keys - parameter_names
+      unless unknown_names.empty?
+        raise ArgumentError,
+              "unknown parameters: <#{unknown_names.inspect}>: " +
+              "available: <#{parameter_names.inspect}>"
+      end
+      @parameters.each do |name, variable|
+        unless normalized_values.has_key?(name)
+          raise ArgumentError, "parameter isn't specified: <#{name.inspect}>"
+        end
+        variable.value = normalized_values[name]
+      end
+    end
+  end
+end
@@ -0,0 +1,194 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2011  Kouhei Sutou <kou@clear-code.com>
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1 as published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+require "thread"
+
+require "groonga"
+require "groonga/query-log"
+
+module Groonga
+  module QueryLog
+    # クエリログに記録されたコマンドをローカルのデータベースか
+    # groongaサーバに対して再実行し、コマンド毎の経過時間を
+    # LatencyHistogram に記録する。
+    class Replayer
+      include LatencyReport
+
+      attr_reader :histograms, :n_commands, :n_errors
+      # @param [::Hash] options The name and value
+      #   pairs. Omitted names are initialized as the default value.
+      # @option options [String] :database
+      #
+      #   コマンドを実行するデータベースのパス。指定しない場合は
+      #   _:host_ と _:port_ で指定したgroongaサーバに接続する。
+      # @option options [String] :host ("localhost")
+      # @option options [Integer] :port (10041)
+      # @option options [Integer] :n_clients (1)
+      #
+      #   同時にコマンドを実行するクライアント数。クライアント毎
+      #   にGroonga::Contextを作る。 _:database_ を指定した場合は
+      #   データベースは1回だけ開き、全てのクライアントで共有する。コマンドの送受信中はGVLを解放
+      #   するので、クライアントは並行して動く。ただし、バッファ
+      #   リングしていない Groonga::Logger が登録されている場合は
+      #   GVLを解放できないので、1つずつ実行する。
+      # @option options [Numeric] :speed
+      #
+      #   クエリログに記録された間隔の何倍の速さでコマンドを実
+      #   行するか。2なら半分の間隔で実行する。指定しないか0以下
+      #   の場合は待たずに実行する。コマンドはクエリログで開始し
+      #   た順に実行する。
+      def initialize(options={})
+        @database_path = options[:database]
+        @host = options[:host] || "localhost"
+        @port = options[:port] || 10041
+        @n_clients = options[:n_clients] || 1
+        @speed = options[:speed]
+        if @n_clients < 1
+          raise ArgumentError,
+                "the number of clients should be 1 or larger: <#{@n_clients}>"
+        end
+        @histograms = {}
+        @n_commands = 0
+        @n_errors = 0
+        @mutex = Mutex.new
+      end
+
+      # レスポンスのステータスがエラーのコマンドもエラーとして数
+      # えるため、コマンドの出力形式はJSONにして実行する。
+      def replay(input)
+        current_logger = Logger.current
+        without_gvl = (current_logger.nil? or current_logger.buffered?)
+        @io_options = {:without_gvl => without_gvl}
+        queue = SizedQueue.new(@n_clients * 100)
+        feeder = Thread.current
+        open_database do |database|
+          clients = (0...@n_clients).collect do
+            Thread.new do
+              begin
+                run_client(queue, database)
+              rescue Exception
+                feeder.raise($!)
+              end
+            end
+          end
+          begin
+            feed(input, queue)
+          ensure
+            clients.each do |client|
+              queue.push(nil) if client.alive?
+            end
+            clients.each do |client|
+              client.join
+            end
+          end
+        end
+        self
+      end
+
+      def report(output)
+        report_latencies(output, @histograms)
+        output.puts
+        output.puts("commands: #{@n_commands}, errors: #{@n_errors}")
+      end
+
+      private
+      def feed(input, queue)
+        parser = Parser.new(:trigger => :start)
+        base_log_time = nil
+        base_time = nil
+        parser.parse(input) do |statistic|
+          if @speed and @speed > 0
+            base_log_time ||= statistic.start_time
+            base_time ||= Time.now
+            wait = (statistic.start_time - base_log_time) / @speed -
+              (Time.now - base_time)
+            sleep(wait) if wait > 0
+          end
+          command = statistic.command
+          command.parameters["output_type"] = "json"
+          queue.push(command)
+        end
+      end
+
+      # Clients share one database handle instead of opening the
+      # database for each client.
+      def open_database
+        return yield(nil) unless @database_path
+        context = Context.new
+        begin
+          context.open_database(@database_path) do |database|
+            yield(database)
+          end
+        ensure
+          context.close
+        end
+      end
+
+      def run_client(queue, database)
+        context = create_context(database)
+        begin
+          while (command = queue.pop)
+            execute(context, command)
+          end
+        ensure
+          context.close
+        end
+      end
+
+      def execute(context, command)
+        start_time = Time.now
+        begin
+          context.send(command.to_command_format, @io_options)
+          _, response = context.receive(@io_options)
+          success = success_response?(response)
+        rescue Groonga::Error
+          success = false
+        end
+        elapsed = ((Time.now - start_time) * 1_000_000_000).round
+        unless success
+          @mutex.synchronize do
+            @n_commands += 1
+            @n_errors += 1
+          end
+          return
+        end
+        @mutex.synchronize do
+          @n_commands += 1
+          histogram = (@histograms[command.name] ||= LatencyHistogram.new)
+          histogram.add(elapsed)
+        end
+      end
+
+      # groongaサーバで発生したエラーは例外にならずにレスポンス
+      # のヘッダーの"[[リターンコード, ..."で返ってくる。
+      def success_response?(response)
+        return true unless /\A\s*\[\s*\[\s*(-?\d+)/ =~ response
+        $1.to_i.zero?
+      end
+
+      def create_context(database)
+        context = Context.new
+        if database
+          context.use_database(database)
+        else
+          context.connect(:host => @host, :port => @port)
+        end
+        context
+      end
+    end
+  end
+end
@@ -21,6 +21,93 @@ require "cgi"
 
 module Groonga
   module QueryLog
+    # Groonga::QueryLog.registerで +:buffered+ のときのデフォル
+    # トのメッセージの最大バイト数。
+    DEFAULT_BUFFERED_MESSAGE_SIZE = 64 * 1024
+
+    class << self
+      # groongaがクエリログを出力する度にそれを解析し、コマンド
+      # が終了する度に Groonga::QueryLog::Statistic をブロックに
+      # 渡す。ファイルに書き出したクエリログを後から解析しなくて
+      # もよいので、遅いクエリを実行中に検出できる。
+      #
+      # Groonga::Logger.registerでロガーを登録する。すでに
+      # Groonga::Logger.registerで登録されているロガーがある場
+      # 合はクエリログ以外のログをそのロガーのブロックに渡す。
+      # groongaのデフォルトロガーを使っている場合は、
+      # Groonga::QueryLog.unregisterを呼ぶまでログファイルへの
+      # 出力は行われなくなる。
+      #
+      # @param [::Hash] options The name and value
+      #   pairs. Omitted names are initialized as the default value.
+      # @option options [Symbol] :level
+      #
+      #   Groonga::Logger.registerに渡すログレベル。デフォルトで
+      #   は登録されていたロガーのレベル。登録されていたロガーが
+      #   ない場合は +:none+ 。クエリログは +:none+ で出力される
+      #   ので、 +:none+ のときはクエリログ以外のログはRubyのレベ
+      #   ルには渡されない。
+      # @option options [Boolean] :buffered (false)
+      #
+      #   +true+ を指定するとログをリングバッファに書き込み、
+      #   Rubyのスレッドからまとめて解析する。 +:buffer_size+ と
+      #   +:interval+ も指定できる。詳細は
+      #   Groonga::Logger.registerを参照。
+      # @option options [Integer] :message_size (DEFAULT_BUFFERED_MESSAGE_SIZE)
+      #
+      #   +:buffered+ のときのメッセージの最大バイト数。これより
+      #   長いコマンドは切り詰められるので解析しない。
+      # @option options [Numeric] :slow_operation_threshold (0.1)
+      # @option options [Numeric] :slow_response_threshold (0.2)
+      #
+      #   Groonga::QueryLog::Statistic#slow? などで使う閾値(秒)。
+      # @return [Groonga::Logger] 登録したロガー。
+      def register(options={}, &block)
+        unregister
+        options = options.dup
+        parser = Parser.new(:slow_operation_threshold =>
+                              options.delete(:slow_operation_threshold),
+                            :slow_response_threshold =>
+                              options.delete(:slow_response_threshold))
+        previous_logger = Logger.current
+        if previous_logger
+          options[:level] ||= previous_logger.level
+        else
+          options[:level] ||= :none
+        end
+        message_size = nil
+        if options[:buffered]
+          options[:message_size] ||= DEFAULT_BUFFERED_MESSAGE_SIZE
+          message_size = options[:message_size]
+        end
+        logger = Logger.register(options) do |*arguments|
+          level, time, title, message, location = arguments
+          if level == :none
+            next if message_size and truncated?(message, message_size)
+            parser.parse_line("#{time}|#{message}", &block)
+          elsif previous_logger
+            previous_logger.handler.call(*arguments)
+          end
+        end
+        @logger = logger
+        @previous_logger = previous_logger
+        logger
+      end
+
+      # Groonga::QueryLog.registerで登録したロガーの登録を解除
+      # し、その前に登録されていたロガーに戻す。
+      def unregister
+        return if @logger.nil?
+        Logger.current = @previous_logger if Logger.current == @logger
+        @logger = @previous_logger = nil
+      end
+
+      private
+      def truncated?(message, message_size)
+        message.bytesize == message_size - 1 and /\.\.\.\z/ =~ message
+      end
+    end
+
     class Command
       class << self
         @@registered_commands = {}
@@ -28,6 +115,17 @@ module Groonga
           @@registered_commands[name] = klass
         end
 
+        # コマンドをすべて解析せずにコマンド名だけを取り出す。
+        def extract_name(input)
+          if input.start_with?("/d/")
+            name_end = input.index(/[.?]/, 3) || input.size
+            input[3, name_end - 3]
+          else
+            name_end = input.index(" ") || input.size
+            input[0, name_end]
+          end
+        end
+
         def parse(input)
           if input.start_with?("/d/")
             parse_uri_path(input)
@@ -252,6 +350,15 @@ module Groonga
         command.name == "select"
       end
 
+      # @return [Integer, nil] selectの"select"の処理でヒットし
+      #   たレコード数。記録されていない場合は +nil+ 。
+      def n_hits
+        operation = @operations.find do |_operation|
+          _operation[:name] == "select"
+        end
+        operation ? operation[:n_records] : nil
+      end
+
       private
       def nano_seconds_to_seconds(nano_seconds)
         nano_seconds / 1000.0 / 1000.0 / 1000.0
@@ -293,36 +400,307 @@ module Groonga
       end
     end
 
-    class Parser
+    # 経過時間(ナノ秒)の分布を記録する。2の累乗毎の区間をさら
+    # に128個に分けたバケツで数えるので、記録した数に関わらず
+    # 使うメモリーは一定で、パーセンタイルの誤差は RESOLUTION
+    # (約0.8%)以下になる。
+    class LatencyHistogram
+      N_SUB_BUCKET_BITS = 7
+      N_SUB_BUCKETS = 2 ** N_SUB_BUCKET_BITS
+      # パーセンタイルの相対誤差の上限。
+      RESOLUTION = 1.0 / N_SUB_BUCKETS
+
+      attr_reader :count, :total, :min, :max
       def initialize
+        @buckets = {}
+        @count = 0
+        @total = 0
+        @min = nil
+        @max = nil
+      end
+
+      def add(elapsed)
+        index = bucket_index(elapsed)
+        @buckets[index] = (@buckets[index] || 0) + 1
+        @count += 1
+        @total += elapsed
+        @min = elapsed if @min.nil? or elapsed < @min
+        @max = elapsed if @max.nil? or elapsed > @max
+        self
+      end
+      alias_method :<<, :add
+
+      def merge!(other)
+        other.each_bucket do |index, count|
+          @buckets[index] = (@buckets[index] || 0) + count
+        end
+        @count += other.count
+        @total += other.total
+        @min = other.min if @min.nil? or (other.min and other.min < @min)
+        @max = other.max if @max.nil? or (other.max and other.max > @max)
+        self
+      end
+
+      def empty?
+        @count.zero?
+      end
+
+      def average
+        return nil if empty?
+        @total / @count.to_f
+      end
+
+      # @param [Numeric] percent 0から100までの値。
+      # @return [Integer, nil] _percent_ %の値が収まるバケツの
+      #   上限。ただし記録した最大値を超えることはない。
+      def percentile(percent)
+        return nil if empty?
+        rank = (@count * percent / 100.0).ceil
+        rank = 1 if rank < 1
+        seen = 0
+        @buckets.keys.sort.each do |index|
+          seen += @buckets[index]
+          if seen >= rank
+            return [bucket_upper_bound(index), @max].min
+          end
+        end
+        @max
       end
 
-      def parse(input, &block)
-        current_statistics = {}
+      def each_bucket(&block)
+        @buckets.each(&block)
+      end
+
+      private
+      def bucket_index(elapsed)
+        return elapsed if elapsed < N_SUB_BUCKETS
+        exponent = bit_length(elapsed) - 1
+        shift = exponent - N_SUB_BUCKET_BITS
+        (exponent - N_SUB_BUCKET_BITS + 1) * N_SUB_BUCKETS +
+          ((elapsed >> shift) & (N_SUB_BUCKETS - 1))
+      end
+
+      def bucket_upper_bound(index)
+        return index if index < N_SUB_BUCKETS
+        shift = index / N_SUB_BUCKETS - 1
+        sub_bucket = index % N_SUB_BUCKETS
+        ((N_SUB_BUCKETS + sub_bucket + 1) << shift) - 1
+      end
+
+      def bit_length(value)
+        length = 0
+        while value > 0
+          value >>= 1
+          length += 1
+        end
+        length
+      end
+    end
+
+    module LatencyReport
+      private
+      # コマンド名と LatencyHistogram のHashからコマンド毎の件
+      # 数、平均、パーセンタイル、最大値をTSVで出力する。
+      def report_latencies(output, histograms)
+        output.puts(["command", "count", "average", "50%", "90%", "99%",
+                     "max"].join("\t"))
+        histograms.keys.sort.each do |command_name|
+          histogram = histograms[command_name]
+          data = [
+            command_name,
+            histogram.count,
+            format_elapsed(histogram.average),
+            format_elapsed(histogram.percentile(50)),
+            format_elapsed(histogram.percentile(90)),
+            format_elapsed(histogram.percentile(99)),
+            format_elapsed(histogram.max),
+          ]
+          output.puts(data.join("\t"))
+        end
+      end
+
+      def format_elapsed(elapsed)
+        return "-" if elapsed.nil?
+        "%.3fms" % (elapsed / 1_000_000.0)
+      end
+    end
+
+    # 巨大なクエリログを少ないメモリーで解析し、コマンド毎の経過
+    # 時間の分布と遅いクエリを集計する。
+    #
+    # Parserと違って行毎に正規表現やTimeを使わずに必要な部分だ
+    # けを切り出す。解析中に保持するのは実行中のコマンド、コマ
+    # ンド毎の LatencyHistogram と遅いクエリ上位 _:n_slow_queries_
+    # 件だけなので、ログの大きさに関わらずメモリー使用量は一定に
+    # なる。
+    class Analyzer
+      include LatencyReport
+
+      SlowQuery = Struct.new(:elapsed, :start_time, :command_name,
+                             :raw_command, :return_code)
+
+      attr_reader :n_commands, :histograms, :slow_queries
+      # @return [Integer] 終了した行("<")がないまま捨てたコマン
+      #   ドの数。
+      attr_reader :n_dropped_commands
+      # @param [::Hash] options The name and value
+      #   pairs. Omitted names are initialized as the default value.
+      # @option options [Integer] :n_slow_queries (10)
+      #   保持する遅いクエリの数。
+      # @option options [Integer] :max_running_commands (1000)
+      #   終了していないコマンドを保持する最大数。これを超えると
+      #   古いコマンドから捨てる。同じコンテキストで次のコマン
+      #   ドが始まった場合も前のコマンドは捨てる。
+      def initialize(options={})
+        @n_slow_queries = options[:n_slow_queries] || 10
+        @max_running_commands = options[:max_running_commands] || 1000
+        @running_commands = {}
+        @n_dropped_commands = 0
+        @histograms = {}
+        @slow_queries = []
+        @n_commands = 0
+      end
+
+      def analyze(input)
         input.each_line do |line|
-          case line
-          when /\A(\d{4})-(\d\d)-(\d\d) (\d\d):(\d\d):(\d\d)\.(\d+)\|(.+?)\|([>:<])/
-            year, month, day, hour, minutes, seconds, micro_seconds =
-              $1, $2, $3, $4, $5, $6, $7
-            context_id = $8
-            type = $9
-            rest = $POSTMATCH.strip
-            time_stamp = Time.local(year, month, day, hour, minutes, seconds,
-                                    micro_seconds)
-            parse_line(current_statistics,
-                       time_stamp, context_id, type, rest, &block)
+          analyze_line(line)
+        end
+        self
+      end
+
+      def analyze_line(line)
+        time_end = line.index("|")
+        return if time_end.nil?
+        context_end = line.index("|", time_end + 1)
+        return if context_end.nil?
+        type_position = context_end + 1
+        case line[type_position, 1]
+        when ">"
+          context_id = line[time_end + 1, context_end - time_end - 1]
+          raw_command = line[type_position + 1..-1]
+          raw_command.chomp!
+          if @running_commands.delete(context_id)
+            @n_dropped_commands += 1
+          end
+          @running_commands[context_id] = [line[0, time_end], raw_command]
+          if @running_commands.size > @max_running_commands
+            @running_commands.shift
+            @n_dropped_commands += 1
           end
+        when "<"
+          context_id = line[time_end + 1, context_end - time_end - 1]
+          running_command = @running_commands.delete(context_id)
+          return if running_command.nil?
+          start_time, raw_command = running_command
+          elapsed = line[type_position + 1, 20].to_i
+          rc_position = line.index("rc=", type_position)
+          return_code = rc_position ? line[rc_position + 3, 10].to_i : 0
+          command_name = Command.extract_name(raw_command)
+          @n_commands += 1
+          histogram = (@histograms[command_name] ||= LatencyHistogram.new)
+          histogram.add(elapsed)
+          add_slow_query(elapsed, start_time, command_name,
+                         raw_command, return_code)
+        end
+      end
+
+      # @return [::Array] 遅い順に並べた SlowQuery の配列。
+      def sorted_slow_queries
+        @slow_queries.reverse
+      end
+
+      def report(output)
+        report_latencies(output, @histograms)
+        return if @slow_queries.empty?
+        output.puts
+        output.puts("slow queries:")
+        sorted_slow_queries.each_with_index do |slow_query, i|
+          output.puts("%*d) [%s] %s (rc=%d): %s" %
+                        [@n_slow_queries.to_s.size, i + 1,
+                         slow_query.start_time,
+                         format_elapsed(slow_query.elapsed),
+                         slow_query.return_code,
+                         slow_query.raw_command])
         end
       end
 
       private
-      def parse_line(current_statistics,
-                     time_stamp, context_id, type, rest, &block)
+      def add_slow_query(elapsed, start_time, command_name,
+                         raw_command, return_code)
+        return if @n_slow_queries <= 0
+        if @slow_queries.size >= @n_slow_queries
+          return if elapsed <= @slow_queries.first.elapsed
+          @slow_queries.shift
+        end
+        slow_query = SlowQuery.new(elapsed, start_time, command_name,
+                                   raw_command, return_code)
+        index = @slow_queries.index {|query| query.elapsed > elapsed}
+        @slow_queries.insert(index || @slow_queries.size, slow_query)
+      end
+    end
+
+    class Parser
+      # @param [::Hash] options The name and value
+      #   pairs. Omitted names are initialized as the default value.
+      # @option options [Symbol] :trigger (:finish)
+      #
+      #   +:start+ を指定するとコマンドが終了した行ではなく開始
+      #   した行(">")で Groonga::QueryLog::Statistic をブロック
+      #   に渡す。コマンドを開始した順に渡されるが、経過時間な
+      #   どは設定されていない。
+      # @option options [Numeric] :slow_operation_threshold
+      # @option options [Numeric] :slow_response_threshold
+      #
+      #   Groonga::QueryLog::Statistic#slow? などで使う閾値(秒)。
+      def initialize(options={})
+        @current_statistics = {}
+        @trigger = options[:trigger] || :finish
+        @slow_operation_threshold = options[:slow_operation_threshold]
+        @slow_response_threshold = options[:slow_response_threshold]
+      end
+
+      def parse(input, &block)
+        input.each_line do |line|
+          parse_line(line, &block)
+        end
+      end
+
+      # 1行分のクエリログを解析する。コマンドが終了した行では
+      # Groonga::QueryLog::Statistic をブロックに渡す。終了して
+      # いないコマンドの情報はパーサーが保持しているので、同じ
+      # パーサーに続きの行を渡せばよい。
+      def parse_line(line, &block)
+        case line
+        when /\A(\d{4})-(\d\d)-(\d\d) (\d\d):(\d\d):(\d\d)\.(\d+)\|(.+?)\|([>:<])/
+          year, month, day, hour, minutes, seconds, micro_seconds =
+            $1, $2, $3, $4, $5, $6, $7
+          context_id = $8
+          type = $9
+          rest = $POSTMATCH.strip
+          time_stamp = Time.local(year, month, day, hour, minutes, seconds,
+                                  micro_seconds)
+          parse_entry(time_stamp, context_id, type, rest, &block)
+        end
+      end
+
+      private
+      def parse_entry(time_stamp, context_id, type, rest, &block)
+        current_statistics = @current_statistics
         case type
         when ">"
           statistic = Statistic.new(context_id)
+          if @slow_operation_threshold
+            statistic.slow_operation_threshold = @slow_operation_threshold
+          end
+          if @slow_response_threshold
+            statistic.slow_response_threshold = @slow_response_threshold
+          end
           statistic.start(time_stamp, rest)
-          current_statistics[context_id] = statistic
+          if @trigger == :start
+            block.call(statistic)
+          else
+            current_statistics[context_id] = statistic
+          end
         when ":"
           return unless /\A(\d+) (.+)\((\d+)\)/ =~ rest
           elapsed = $1
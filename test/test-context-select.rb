@@ -130,6 +130,34 @@ class ContextSelectTest < Test::Unit::TestCase
                  result.records)
   end
 
+  def test_records_pluck
+    result = context.select(@books)
+    assert_equal([Time.parse("2010/04/01"), Time.parse("2011/04/01")],
+                 result.records.pluck("published"))
+  end
+
+  def test_records_reference
+    result = context.select(@users, :output_columns => ["_key"])
+    assert_equal([4, {"_key" => "ryoqun"}, {"_key" => "morita"}],
+                 [result.records.size,
+                  result.records[3],
+                  result.records.first])
+  end
+
+  def test_records_slice
+    records = context.select(@users, :output_columns => ["_key"]).records
+    assert_equal([[{"_key" => "morita"}, {"_key" => "gunyara-kun"}],
+                  [{"_key" => "gunyara-kun"}, {"_key" => "yu"}],
+                  {"_key" => "ryoqun"},
+                  [{"_key" => "yu"}, {"_key" => "ryoqun"}],
+                  nil],
+                 [records[0..1],
+                  records[1, 2],
+                  records.last,
+                  records.last(2),
+                  records[10, 1]])
+  end
+
   def test_invalid
     assert_raise(Groonga::SyntaxError) do
       context.select(@books, :query => "<")
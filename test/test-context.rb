@@ -65,6 +65,19 @@ class ContextTest < Test::Unit::TestCase
     assert_predicate(database, :closed?)
   end
 
+  def test_use_database
+    db_path = @tmp_dir + "db"
+    context = Groonga::Context.new
+    database = context.create_database(db_path.to_s)
+    Groonga::Hash.create(:name => "Users", :context => context)
+
+    other_context = Groonga::Context.new
+    assert_equal(database, other_context.use_database(database))
+    assert_not_nil(other_context["Users"])
+    other_context.close
+    assert_not_predicate(database, :closed?)
+  end
+
   def test_encoding
     context = Groonga::Context.new
     assert_equal(Groonga::Encoding.default, context.encoding)
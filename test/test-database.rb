@@ -130,6 +130,14 @@ class DatabaseTest < Test::Unit::TestCase
     end
   end
 
+  def test_modification_count
+    setup_database
+    users = Groonga::Array.create(:name => "Users")
+    count = @database.modification_count
+    users.add
+    assert_operator(count, :<, @database.modification_count)
+  end
+
   def test_defrag
     setup_database
     Groonga::Schema.define do |schema|
@@ -145,4 +153,93 @@ class DatabaseTest < Test::Unit::TestCase
     end
     assert_equal(7, @database.defrag)
   end
+
+  def test_defrag_incremental
+    setup_database
+    Groonga::Schema.define do |schema|
+      schema.create_table("Users") do |table|
+        table.short_text("name")
+        table.short_text("address")
+      end
+    end
+    users = context["Users"]
+    1000.times do |i|
+      users.add(:name => "user #{i}" * 1000,
+                :address => "address #{i}" * 1000)
+    end
+
+    defraged_columns = []
+    n_segments = @database.defrag(:soft_timeout => 0) do |column, _|
+      defraged_columns << column.name
+    end
+    assert_equal(["Users.name"], defraged_columns)
+    assert_true(@database.defrag_in_progress?)
+
+    n_segments += @database.defrag(:soft_timeout => 0,
+                                   :without_gvl => true) do |column, _|
+      defraged_columns << column.name
+    end
+    assert_equal(["Users.name", "Users.address"], defraged_columns)
+    assert_equal(7, n_segments)
+    assert_false(@database.defrag_in_progress?)
+  end
+
+  def test_defrag_incremental_with_break
+    setup_database
+    Groonga::Schema.define do |schema|
+      schema.create_table("Users") do |table|
+        table.short_text("name")
+        table.short_text("address")
+      end
+    end
+
+    defraged_columns = []
+    @database.defrag do |column, _|
+      defraged_columns << column.name
+      break
+    end
+    assert_true(@database.defrag_in_progress?)
+    @database.defrag do |column, _|
+      defraged_columns << column.name
+    end
+    assert_equal(["Users.name", "Users.address"], defraged_columns)
+    assert_false(@database.defrag_in_progress?)
+  end
+
+  def test_defrag_incremental_with_exception
+    setup_database
+    Groonga::Schema.define do |schema|
+      schema.create_table("Users") do |table|
+        table.short_text("name")
+        table.short_text("address")
+      end
+    end
+
+    defraged_columns = []
+    assert_raise(RuntimeError) do
+      @database.defrag do |column, _|
+        defraged_columns << column.name
+        raise "stop"
+      end
+    end
+    assert_true(@database.defrag_in_progress?)
+    @database.defrag do |column, _|
+      defraged_columns << column.name
+    end
+    assert_equal(["Users.name", "Users.address"], defraged_columns)
+    assert_false(@database.defrag_in_progress?)
+  end
+
+  def test_defrag_without_gvl_with_logger
+    setup_database
+    Groonga::Logger.register do |*args|
+    end
+    begin
+      assert_raise(ArgumentError) do
+        @database.defrag(:without_gvl => true)
+      end
+    ensure
+      Groonga::Logger.unregister
+    end
+  end
 end
@@ -74,4 +74,19 @@ class FixSizeColumnTest < Test::Unit::TestCase
     assert_equal([title, Time.at(issued)],
                  [record["title"], record["issued"]])
   end
+
+  def test_time_format
+    comments = Groonga::Array.create(:name => "Comments")
+    issued_column = comments.define_column("issued", "Time")
+    issued = Time.at(1187430026, 123456)
+    record = comments.add(:issued => issued)
+
+    issued_column.time_format = :usec
+    usec = record["issued"]
+    issued_column.time_format = :float
+    float = record["issued"]
+    issued_column.time_format = :time
+    assert_equal([1187430026123456, issued.to_f, issued, :time],
+                 [usec, float, record["issued"], issued_column.time_format])
+  end
 end
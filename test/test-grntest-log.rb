@@ -0,0 +1,91 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2011  Kouhei Sutou <kou@clear-code.com>
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1 as published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+class GrntestLogSummarizerTest < Test::Unit::TestCase
+  def test_summarize
+    summary = summarize(1)
+    select = summary.commands["select"]
+    assert_equal([3, 2, 1],
+                 [summary.n_queries,
+                  select.n_queries,
+                  summary.commands["status"].n_queries])
+    assert_equal([1000000, 2000000],
+                 [select.histogram.min, select.histogram.max])
+    assert_in_delta(2 / 0.004, select.qps, 0.001)
+  end
+
+  def test_compare
+    base = summarize(1)
+    current = summarize(2)
+    regressions = current.compare(base).collect do |regression|
+      [regression.command_name, regression.metric]
+    end
+    assert_equal([["select", "50%"], ["select", "90%"], ["select", "99%"],
+                  ["select", "qps"],
+                  ["status", "50%"], ["status", "90%"], ["status", "99%"],
+                  ["status", "qps"]],
+                 regressions)
+    assert_equal([], base.compare(current))
+  end
+
+  def test_compare_small_regression
+    regressions = summarize(21).compare(summarize(20), :threshold => 0.03)
+    assert_equal([["select", "50%"], ["select", "90%"], ["select", "99%"],
+                  ["select", "qps"],
+                  ["status", "50%"], ["status", "90%"], ["status", "99%"],
+                  ["status", "qps"]],
+                 regressions.collect {|regression|
+                   [regression.command_name, regression.metric]
+                 })
+  end
+
+  def test_compare_too_small_threshold
+    assert_raise(ArgumentError) do
+      summarize(1).compare(summarize(1), :threshold => 0.001)
+    end
+  end
+
+  private
+  def summarize(scale)
+    summarizer = Groonga::GrntestLog::Summarizer.new
+    summarizer.summarize(StringIO.new(log(scale)))
+  end
+
+  def log(scale)
+    <<-EOL
+[{"script": "test.scr",
+"user": "groonga",
+"date": "2011-11-14 12:00:00",
+"CPU": "Intel(R) Core(TM)2 Duo CPU",
+"BIT": 64,
+"CORE": 2,
+"RAM": "2048MBytes",
+"HDD": "100000MBytes",
+"OS": "Linux",
+"HOST": "localhost",
+"PORT": "10041",
+"VERSION": "1.2.8"
+},
+{"jobs": "rurl test.scr",
+"detail": [
+[0, "select --table Users", 0, #{1000 * scale}, 0],
+[1, "/d/status", #{1000 * scale}, #{2000 * scale}, 0],
+[2, "/d/select.json?table=Users", #{2000 * scale}, #{4000 * scale}, 0]],
+"summary": [{"job": "rurl test.scr", "latency": #{4000 * scale}, "self": #{4000 * scale}, "qps": 750.0, "min": #{1000 * scale}, "max": #{2000 * scale}, "queries": 3}]},
+    EOL
+  end
+end
@@ -0,0 +1,94 @@
+# Copyright (C) 2011  Kouhei Sutou <kou@clear-code.com>
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1 as published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+class IdBitmapTest < Test::Unit::TestCase
+  include GroongaTestUtils
+
+  setup :setup_database
+
+  def test_add
+    bitmap = Groonga::IdBitmap.new([3, 1])
+    bitmap << 2 << 70000 << 1
+    assert_equal([[1, 2, 3, 70000], 4, true, false],
+                 [bitmap.to_a, bitmap.size,
+                  bitmap.include?(70000), bitmap.include?(4)])
+  end
+
+  def test_dense
+    ids = (1..10000).to_a
+    bitmap = Groonga::IdBitmap.new(ids)
+    assert_equal([ids, 10000], [bitmap.to_a, bitmap.size])
+    assert_operator(bitmap.memory_size, :<, ids.size * 2)
+  end
+
+  def test_set_operation
+    dense = Groonga::IdBitmap.new((1..5000).to_a + [70001])
+    odd = Groonga::IdBitmap.new((1..10).select {|id| id.odd?} + [70000])
+    assert_equal([[1, 3, 5, 7, 9],
+                  (1..10).to_a + (11..5000).to_a + [70000, 70001],
+                  [2, 4, 6, 8] + (10..5000).to_a + [70001]],
+                 [(dense & odd).to_a,
+                  (dense | odd).to_a,
+                  (dense - odd).to_a])
+  end
+
+  def test_table_set_operation
+    users = Groonga::Hash.create(:name => "Users", :key_type => "ShortText")
+    users.define_column("age", "UInt32")
+    alice = users.add("alice", :age => 20)
+    bob = users.add("bob", :age => 30)
+    chris = users.add("chris", :age => 40)
+
+    result = users.select {|record| record.age > 25}
+    result.intersection!(Groonga::IdBitmap.new([alice.id, bob.id]))
+    assert_equal(["bob"], result.collect {|record| record.key.key})
+
+    result.union!(Groonga::IdBitmap.new([chris.id]))
+    assert_equal(["bob", "chris"],
+                 result.collect {|record| record.key.key}.sort)
+
+    result.difference!(users.select {|record| record.age > 35}.to_id_bitmap)
+    assert_equal(["bob"], result.collect {|record| record.key.key})
+  end
+
+  def test_union_large
+    users = Groonga::Array.create(:name => "Users")
+    users.define_column("age", "UInt32")
+    ids = []
+    70010.times {ids << users.add.id}
+
+    result = users.select {|record| record.age > 100}
+    result.union!(Groonga::IdBitmap.new(ids[0, 5] + ids[-5, 5]))
+    assert_equal([ids[0, 5] + ids[-5, 5], [1] * 10],
+                 [result.collect {|record| record.key.id}.sort,
+                  result.collect {|record| record.score}])
+  end
+
+  def test_select_ids
+    users = Groonga::Hash.create(:name => "Users", :key_type => "ShortText")
+    users.define_column("age", "UInt32")
+    alice = users.add("alice", :age => 20)
+    bob = users.add("bob", :age => 30)
+    chris = users.add("chris", :age => 40)
+
+    bitmap = users.select("age:>25", :id_bitmap => true)
+    result = users.select("age:<35", :ids => bitmap)
+    assert_equal([["bob", 1]],
+                 result.collect {|record| [record.key.key, record.score]})
+    assert_equal([bob.id],
+                 users.select("age:<35", :ids => bitmap,
+                              :id_bitmap => true).to_a)
+  end
+end
@@ -22,6 +22,7 @@ class LoggerTest < Test::Unit::TestCase
   end
 
   def teardown
+    Groonga::Logger.unregister
     Groonga::Logger.log_path = @default_log_path
     Groonga::Logger.query_log_path = @default_query_log_path
   end
@@ -34,4 +35,81 @@ class LoggerTest < Test::Unit::TestCase
     Groonga::Logger.reopen
     assert_true(File.exist?(@default_log_path))
   end
+
+  def test_buffered
+    messages = []
+    logger = Groonga::Logger.register(:buffered => true,
+                                      :interval => 60) do |*args|
+      messages << args[3]
+    end
+    assert_true(logger.buffered?)
+    open_nonexistent_database
+    assert_operator(0, :<, logger.flush)
+    assert_equal([true, 0],
+                 [messages.any? {|message| message.include?(nonexistent_path)},
+                  logger.n_dropped])
+  end
+
+  def test_buffered_overflow
+    logger = Groonga::Logger.register(:buffered => true,
+                                      :buffer_size => 1,
+                                      :interval => 60) do |*args|
+    end
+    3.times do
+      open_nonexistent_database
+    end
+    assert_equal(1, logger.flush)
+    assert_operator(0, :<, logger.n_dropped)
+  end
+
+  def test_buffered_truncated_message
+    messages = []
+    logger = Groonga::Logger.register(:buffered => true,
+                                      :message_size => 16,
+                                      :interval => 60) do |*args|
+      messages << args[3]
+    end
+    open_nonexistent_database
+    logger.flush
+    assert_equal([15, "..."], [messages[0].size, messages[0][-3, 3]])
+  end
+
+  def test_buffered_exception_in_block
+    n_calls = 0
+    logger = Groonga::Logger.register(:buffered => true,
+                                      :interval => 0.01) do |*args|
+      n_calls += 1
+      raise "failed"
+    end
+    open_nonexistent_database
+    sleep(0.1)
+    open_nonexistent_database
+    sleep(0.1)
+    assert_operator(1, :<, n_calls)
+  end
+
+  def test_unregister
+    messages = []
+    Groonga::Logger.register(:buffered => true,
+                             :interval => 60) do |*args|
+      messages << args[3]
+    end
+    open_nonexistent_database
+    Groonga::Logger.unregister
+    assert_operator(0, :<, messages.size)
+    messages.clear
+    open_nonexistent_database
+    assert_equal([], messages)
+  end
+
+  private
+  def nonexistent_path
+    (@tmp_dir + "nonexistent" + "db").to_s
+  end
+
+  def open_nonexistent_database
+    assert_raise(Groonga::NoSuchFileOrDirectory) do
+      Groonga::Database.new(nonexistent_path)
+    end
+  end
 end
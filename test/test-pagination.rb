@@ -223,6 +223,63 @@ class PaginationTest < Test::Unit::TestCase
                     :size => 50)
   end
 
+  def test_keyset
+    first_page = @users.paginate([["number", :desc]],
+                                 :size => 60, :after => nil)
+    assert_equal([(91..150).collect {|i| "user#{i}"}.reverse,
+                  true,
+                  [91, @users["user91"].id]],
+                 [first_page.collect {|user| user.key},
+                  first_page.have_next_page?,
+                  first_page.next_page_cursor])
+
+    second_page = @users.paginate([["number", :desc]],
+                                  :size => 60,
+                                  :after => first_page.next_page_cursor)
+    assert_equal([(31..90).collect {|i| "user#{i}"}.reverse, true],
+                 [second_page.collect {|user| user.key},
+                  second_page.have_next_page?])
+
+    last_page = @users.paginate([["number", :desc]],
+                                :size => 60,
+                                :after => second_page.last)
+    assert_equal([(1..30).collect {|i| "user#{i}"}.reverse, false, nil],
+                 [last_page.collect {|user| user.key},
+                  last_page.have_next_page?,
+                  last_page.next_page_cursor])
+  end
+
+  def test_keyset_after_nil
+    assert_raise(ArgumentError) do
+      @users.paginate([["number", :desc]],
+                      :size => 60, :after => [nil, @users["user1"].id])
+    end
+  end
+
+  def test_paginator
+    paginator = @users.paginator([["number"]], :size => 50)
+    page = paginator.page(2)
+    assert_equal([(51..100).collect {|i| "user#{i}"}, 2, 3, 150],
+                 [page.collect {|user| user.key},
+                  page.current_page,
+                  page.n_pages,
+                  page.n_records])
+
+    @users.add("user0", :number => 0)
+    page = paginator.page(1)
+    assert_equal([(0..49).collect {|i| "user#{i}"}, 4, 151],
+                 [page.collect {|user| user.key},
+                  page.n_pages,
+                  page.n_records])
+  end
+
+  def test_paginator_limit
+    paginator = @users.paginator([["number"]], :size => 50, :limit => 60)
+    assert_equal([(101..150).collect {|i| "user#{i}"}, 150],
+                 [paginator.page(3).collect {|user| user.key},
+                  paginator.n_records])
+  end
+
   private
   def assert_paginate(expected, options={})
     users = @users.paginate([["number"]], options)
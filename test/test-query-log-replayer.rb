@@ -0,0 +1,74 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2011  Kouhei Sutou <kou@clear-code.com>
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1 as published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+require "groonga/query-log-replayer"
+
+class QueryLogReplayerTest < Test::Unit::TestCase
+  include GroongaTestUtils
+
+  setup :setup_database
+
+  setup
+  def setup_users
+    Groonga::Schema.define do |schema|
+      schema.create_table("Users", :type => :hash) do |table|
+        table.short_text("name")
+      end
+    end
+  end
+
+  def test_replay
+    replayer = Groonga::QueryLog::Replayer.new(:database => @database_path.to_s,
+                                               :n_clients => 2)
+    replayer.replay(StringIO.new(log))
+    counts = {}
+    replayer.histograms.each do |name, histogram|
+      counts[name] = histogram.count
+    end
+    assert_equal([3, 0, {"select" => 2, "status" => 1}],
+                 [replayer.n_commands, replayer.n_errors, counts])
+  end
+
+  def test_replay_error
+    replayer = Groonga::QueryLog::Replayer.new(:database => @database_path.to_s)
+    replayer.replay(StringIO.new(<<-EOL))
+2011-06-02 16:27:04.731685|5091e5c0|>select --table Nonexistent
+2011-06-02 16:27:04.735808|5091e5c0|<000000004123726 rc=-22
+2011-06-02 16:27:05.000000|5091e5c0|>select --table Users
+2011-06-02 16:27:05.000001|5091e5c0|<000000000100000 rc=0
+EOL
+    assert_equal([2, 1], [replayer.n_commands, replayer.n_errors])
+  end
+
+  def test_invalid_n_clients
+    assert_raise(ArgumentError) do
+      Groonga::QueryLog::Replayer.new(:n_clients => 0)
+    end
+  end
+
+  private
+  def log
+    <<-EOL
+2011-06-02 16:27:04.731685|5091e5c0|>/d/select.json?table=Users
+2011-06-02 16:27:04.731686|5091e5c1|>status
+2011-06-02 16:27:04.735808|5091e5c0|<000000004123726 rc=0
+2011-06-02 16:27:04.735809|5091e5c1|<000000003000000 rc=0
+2011-06-02 16:27:05.000000|5091e5c0|>select --table Users --query name:@alice
+2011-06-02 16:27:05.000001|5091e5c0|<000000000100000 rc=0
+EOL
+  end
+end
@@ -231,6 +231,18 @@ module QueryLogTest
       assert_equal(expected, operations)
     end
 
+    def test_max_running_commands
+      analyzer = Groonga::QueryLog::Analyzer.new(:max_running_commands => 1)
+      analyzer.analyze(StringIO.new(<<-EOL))
+2011-06-02 16:27:04.000000|5091e5c0|>status
+2011-06-02 16:27:04.000001|5091e5c0|>status
+2011-06-02 16:27:04.000002|5091e5c1|>select --table Entries
+2011-06-02 16:27:04.000003|5091e5c0|<000000000100000 rc=0
+2011-06-02 16:27:04.000004|5091e5c1|<000000000200000 rc=0
+EOL
+      assert_equal([1, 2], [analyzer.n_commands, analyzer.n_dropped_commands])
+    end
+
     private
     def log
       <<-EOL
@@ -255,4 +267,191 @@ EOL
       statistics
     end
   end
+
+  class ParserTest < Test::Unit::TestCase
+    def test_parse_line
+      parser = Groonga::QueryLog::Parser.new(:slow_response_threshold => 0.001)
+      statistics = []
+      lines = [
+        "2012-01-23 12:34:56.000001|0x7fff1234|>" +
+          "select --table Users --query follower:@groonga",
+        "2012-01-23 12:34:56.000002|0x7fff1234|:000000000100000 filter(2)",
+        "2012-01-23 12:34:56.000003|0x7fff1234|:000000000200000 select(2)",
+        "2012-01-23 12:34:56.000004|0x7fff1234|:000000000300000 output(2)",
+        "2012-01-23 12:34:56.000005|0x7fff1234|<000000001500000 rc=0",
+      ]
+      lines.each do |line|
+        parser.parse_line(line) do |statistic|
+          statistics << statistic
+        end
+      end
+      assert_equal(1, statistics.size)
+      statistic = statistics.first
+      assert_equal([2, 1500000, true],
+                   [statistic.n_hits, statistic.elapsed, statistic.slow?])
+      assert_equal([100000, 100000, 100000],
+                   statistic.operations.collect {|operation|
+                     operation[:relative_elapsed]
+                   })
+    end
+  end
+
+  class RegisterTest < Test::Unit::TestCase
+    include GroongaTestUtils
+
+    setup :setup_database
+
+    setup
+    def setup_users
+      Groonga::Array.create(:name => "Users")
+    end
+
+    teardown
+    def teardown_logger
+      Groonga::QueryLog.unregister
+      Groonga::Logger.unregister
+    end
+
+    def test_register
+      statistics = []
+      Groonga::QueryLog.register do |statistic|
+        statistics << statistic
+      end
+      execute("select --table Users")
+      assert_equal([["select", "Users", 0]],
+                   statistics.collect {|statistic|
+                     [statistic.command.name,
+                      statistic.command.parameters["table"],
+                      statistic.return_code]
+                   })
+    end
+
+    def test_register_buffered_long_command
+      statistics = []
+      logger = Groonga::QueryLog.register(:buffered => true,
+                                          :message_size => 64,
+                                          :interval => 60) do |statistic|
+        statistics << statistic
+      end
+      execute("select --table Users " +
+              "--filter '_id > 0 #{'|| _id == 1 ' * 10}'")
+      execute("select --table Users")
+      logger.flush
+      assert_equal([["select", "Users", nil]],
+                   statistics.collect {|statistic|
+                     [statistic.command.name,
+                      statistic.command.parameters["table"],
+                      statistic.command.parameters["filter"]]
+                   })
+    end
+
+    def test_chain
+      messages = []
+      previous_logger = Groonga::Logger.register do |level, *rest|
+        messages << level
+      end
+      Groonga::QueryLog.register do |statistic|
+      end
+      assert_raise(Groonga::NoSuchFileOrDirectory) do
+        Groonga::Database.new((@tmp_dir + "nonexistent" + "db").to_s)
+      end
+      assert_equal([:notice, true],
+                   [Groonga::Logger.current.level, messages.include?(:error)])
+      Groonga::QueryLog.unregister
+      assert_equal(previous_logger, Groonga::Logger.current)
+    end
+
+    private
+    def execute(command)
+      context.send(command)
+      context.receive
+    end
+  end
+
+  class ParserStartTriggerTest < Test::Unit::TestCase
+    def test_start_order
+      parser = Groonga::QueryLog::Parser.new(:trigger => :start)
+      commands = []
+      parser.parse(StringIO.new(<<-EOL)) do |statistic|
+2011-06-02 16:27:04.000000|5091e5c0|>select --table Users
+2011-06-02 16:27:04.000001|5091e5c1|>status
+2011-06-02 16:27:04.000002|5091e5c1|<000000000100000 rc=0
+2011-06-02 16:27:04.000003|5091e5c0|<000000003000000 rc=0
+EOL
+        commands << [statistic.command.name, statistic.elapsed]
+      end
+      assert_equal([["select", nil], ["status", nil]], commands)
+    end
+  end
+
+  class LatencyHistogramTest < Test::Unit::TestCase
+    def setup
+      @histogram = Groonga::QueryLog::LatencyHistogram.new
+    end
+
+    def test_percentile
+      (1..100).each do |elapsed|
+        @histogram << elapsed * 1000
+      end
+      assert_equal([100, 1000, 100000],
+                   [@histogram.count, @histogram.min, @histogram.max])
+      resolution = Groonga::QueryLog::LatencyHistogram::RESOLUTION
+      assert_in_delta(50000, @histogram.percentile(50), 50000 * resolution)
+      assert_in_delta(99000, @histogram.percentile(99), 99000 * resolution)
+      assert_equal(100000, @histogram.percentile(100))
+    end
+
+    def test_empty
+      assert_equal([nil, nil], [@histogram.average, @histogram.percentile(50)])
+    end
+  end
+
+  class AnalyzerTest < Test::Unit::TestCase
+    def setup
+      @analyzer = Groonga::QueryLog::Analyzer.new(:n_slow_queries => 2)
+      @analyzer.analyze(StringIO.new(log))
+    end
+
+    def test_histograms
+      counts = {}
+      @analyzer.histograms.each do |name, histogram|
+        counts[name] = histogram.count
+      end
+      assert_equal([3, {"select" => 2, "status" => 1}],
+                   [@analyzer.n_commands, counts])
+    end
+
+    def test_slow_queries
+      slow_queries = @analyzer.sorted_slow_queries.collect do |slow_query|
+        [slow_query.elapsed, slow_query.command_name, slow_query.return_code]
+      end
+      assert_equal([[4123726, "select", 0], [3000000, "status", -22]],
+                   slow_queries)
+    end
+
+    def test_max_running_commands
+      analyzer = Groonga::QueryLog::Analyzer.new(:max_running_commands => 1)
+      analyzer.analyze(StringIO.new(<<-EOL))
+2011-06-02 16:27:04.000000|5091e5c0|>status
+2011-06-02 16:27:04.000001|5091e5c0|>status
+2011-06-02 16:27:04.000002|5091e5c1|>select --table Entries
+2011-06-02 16:27:04.000003|5091e5c0|<000000000100000 rc=0
+2011-06-02 16:27:04.000004|5091e5c1|<000000000200000 rc=0
+EOL
+      assert_equal([1, 2], [analyzer.n_commands, analyzer.n_dropped_commands])
+    end
+
+    private
+    def log
+      <<-EOL
+2011-06-02 16:27:04.731685|5091e5c0|>/d/select.join?table=Entries
+2011-06-02 16:27:04.731686|5091e5c1|>status
+2011-06-02 16:27:04.733539|5091e5c0|:000000001849451 filter(15)
+2011-06-02 16:27:04.735808|5091e5c0|<000000004123726 rc=0
+2011-06-02 16:27:04.735809|5091e5c1|<000000003000000 rc=-22
+2011-06-02 16:27:05.000000|5091e5c0|>select --table Entries
+2011-06-02 16:27:05.000001|5091e5c0|<000000000100000 rc=0
+EOL
+    end
+  end
 end
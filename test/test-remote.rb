@@ -53,6 +53,48 @@ class RemoteTest < Test::Unit::TestCase
                  values.keys.sort)
   end
 
+  def test_execute_batch
+    context.connect(:host => @host, :port => @port)
+    assert_true(context.connected?)
+    commands = ["table_create Users TABLE_HASH_KEY",
+                "column_create Users age COLUMN_SCALAR UInt32",
+                "table_list"]
+    results = context.execute_batch(commands, :window => 2)
+    assert_equal(["true", "true"], results[0, 2])
+    assert_equal("Users", JSON.load(results[2])[1][1])
+  end
+
+  def test_execute_batch_stop_on_error
+    context.connect(:host => @host, :port => @port)
+    assert_raise(Groonga::InvalidArgument) do
+      context.execute_batch(["select bogus --query '()()'",
+                             "table_create Users TABLE_HASH_KEY"],
+                            :window => 1)
+    end
+    assert_not_match(/Users/, context.execute_batch(["table_list"]).first)
+  end
+
+  def test_execute_batch_error_in_window
+    context.connect(:host => @host, :port => @port)
+    assert_raise(Groonga::InvalidArgument) do
+      context.execute_batch(["select bogus --query '()()'",
+                             "table_create Users TABLE_HASH_KEY"],
+                            :window => 2)
+    end
+    assert_match(/Users/, context.execute_batch(["table_list"]).first)
+  end
+
+  def test_execute_batch_default_window
+    context.connect(:host => @host, :port => @port)
+    assert_raise(Groonga::InvalidArgument) do
+      context.execute_batch(["table_create Users TABLE_HASH_KEY",
+                             "select bogus --query '()()'",
+                             "column_create Users age COLUMN_SCALAR UInt32",
+                             "status"])
+    end
+    assert_match(/Users/, context.execute_batch(["table_list"]).first)
+  end
+
   def test_invalid_select
     context.connect(:host => @host, :port => @port)
 
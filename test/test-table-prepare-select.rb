@@ -0,0 +1,88 @@
+# Copyright (C) 2011  Kouhei Sutou <kou@clear-code.com>
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1 as published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+class TablePrepareSelectTest < Test::Unit::TestCase
+  include GroongaTestUtils
+
+  setup :setup_database
+
+  setup
+  def setup_items
+    @items = Groonga::Array.create(:name => "Items")
+    @items.define_column("name", "ShortText")
+    @items.define_column("price", "Int32")
+    @items.define_column("stock", "Int32")
+
+    @apple = @items.add(:name => "apple", :price => 100, :stock => 3)
+    @banana = @items.add(:name => "banana", :price => 200, :stock => 10)
+    @cherry = @items.add(:name => "cherry", :price => 500, :stock => 1)
+  end
+
+  def test_execute
+    select = @items.prepare_select do |record|
+      record.price < record.param(:max)
+    end
+    assert_equal([:max], select.parameter_names)
+    assert_equal_select_result([@apple], select.execute(:max => 150))
+    assert_equal_select_result([@apple, @banana],
+                               select.execute("max" => 300))
+  end
+
+  def test_multiple_parameters
+    select = @items.prepare_select do |record|
+      (record.price >= record.param(:min)) &
+        (record.stock < record.param(:stock))
+    end
+    assert_equal_select_result([@cherry],
+                               select.execute(:min => 150, :stock => 5))
+    assert_equal_select_result([@apple, @cherry],
+                               select.execute(:min => 0, :stock => 5))
+  end
+
+  def test_same_parameter_twice
+    select = @items.prepare_select do |record|
+      (record.price > record.param(:value)) |
+        (record.stock > record.param(:value))
+    end
+    assert_equal_select_result([@banana, @cherry],
+                               select.execute(:value => 5))
+  end
+
+  def test_expression_reuse
+    select = @items.prepare_select do |record|
+      record.price < record.param(:max)
+    end
+    assert_same(select.expression,
+                select.execute(:max => 300).expression)
+  end
+
+  def test_missing_parameter
+    select = @items.prepare_select do |record|
+      record.price < record.param(:max)
+    end
+    assert_raise(ArgumentError) do
+      select.execute
+    end
+  end
+
+  def test_unknown_parameter
+    select = @items.prepare_select do |record|
+      record.price < record.param(:max)
+    end
+    assert_raise(ArgumentError) do
+      select.execute(:max => 100, :min => 10)
+    end
+  end
+end
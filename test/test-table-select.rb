@@ -66,6 +66,244 @@ class TableSelectTest < Test::Unit::TestCase
     assert_equal_select_result([@comment1, @comment2], result)
   end
 
+  def test_query_expression_not_reused_by_default
+    result = @comments.select("content:@Hello")
+    assert_not_same(result.expression,
+                    @comments.select("content:@Hello").expression)
+  end
+
+  def test_query_with_reuse_expression
+    options = {:reuse_expression => true}
+    result = @comments.select("content:@Hello", options)
+    assert_same(result.expression,
+                @comments.select("content:@Hello", options).expression)
+    assert_not_same(result.expression,
+                    @comments.select("content:@World", options).expression)
+    assert_equal_select_result([@comment2],
+                               @comments.select("content:@World", options))
+  end
+
+  def test_query_with_reuse_expression_and_define_column
+    options = {:reuse_expression => true}
+    result = @comments.select("content:@Hello", options)
+    @comments.define_column("title", "ShortText")
+    assert_not_same(result.expression,
+                    @comments.select("content:@Hello", options).expression)
+  end
+
+  def test_query_with_reuse_expression_and_column_remove_by_command
+    @comments.define_column("title", "ShortText")
+    @comment1["title"] = "Hello"
+    options = {:reuse_expression => true}
+    result = @comments.select("title:@Hello", options)
+    assert_equal_select_result([@comment1], result)
+
+    context.send("column_remove Comments title")
+    context.receive
+    title = @comments.define_column("title", "ShortText")
+    title[@comment2.id] = "Hello"
+    new_result = @comments.select("title:@Hello", options)
+    assert_not_same(result.expression, new_result.expression)
+    assert_equal_select_result([@comment2], new_result)
+  end
+
+  def test_query_with_cache
+    result = @comments.select("content:@Hello", :cache => true)
+    assert_equal_select_result([@comment1, @comment2], result)
+    cached_result = @comments.select("content:@Hello", :cache => true)
+    assert_same(result, cached_result)
+    assert_true(cached_result.frozen?)
+    assert_equal([1, 1], cached_result.collect {|record| record.score})
+
+    assert_raise(RUBY_VERSION >= "1.9" ? RuntimeError : TypeError) do
+      cached_result.delete(cached_result.to_a.first.id)
+    end
+    assert_equal_select_result([@comment1, @comment2],
+                               @comments.select("content:@Hello",
+                                                :cache => true))
+
+    comment4 = @comments.add(:content => "Hello again")
+    new_result = @comments.select("content:@Hello", :cache => true)
+    assert_not_same(result, new_result)
+    assert_equal_select_result([@comment1, @comment2, comment4], new_result)
+  end
+
+  def test_query_with_cache_and_id_bitmap
+    bitmap = @comments.select("content:@Hello",
+                              :cache => true, :id_bitmap => true)
+    assert_true(bitmap.frozen?)
+    assert_raise(RUBY_VERSION >= "1.9" ? RuntimeError : TypeError) do
+      bitmap << @comment3.id
+    end
+  end
+
+  def test_query_with_cache_and_cursor_delete
+    assert_equal_select_result([@comment1, @comment2],
+                               @comments.select("content:@Hello",
+                                                :cache => true))
+    @comments.open_cursor do |cursor|
+      cursor.next
+      cursor.delete
+    end
+    assert_equal_select_result([@comment2],
+                               @comments.select("content:@Hello",
+                                                :cache => true))
+  end
+
+  def test_query_with_cache_and_union
+    other = Groonga::Hash.create(:key_type => "ShortText")
+    other.add("yu")
+    assert_equal_select_result([], @users.select("_key:yu", :cache => true))
+    @users.union!(other)
+    assert_equal_select_result([@users["yu"]],
+                               @users.select("_key:yu", :cache => true))
+  end
+
+  def test_query_with_cache_and_intersection
+    assert_equal_select_result([@users["morita"]],
+                               @users.select("_key:morita", :cache => true))
+    smaller = Groonga::Hash.create(:key_type => "ShortText")
+    smaller.add("darashi")
+    @users.intersection!(smaller)
+    assert_equal_select_result([],
+                               @users.select("_key:morita", :cache => true))
+  end
+
+  def test_query_with_cache_and_difference
+    assert_equal_select_result([@users["morita"]],
+                               @users.select("_key:morita", :cache => true))
+    other = Groonga::Hash.create(:key_type => "ShortText")
+    other.add("morita")
+    @users.difference!(other)
+    assert_equal_select_result([],
+                               @users.select("_key:morita", :cache => true))
+  end
+
+  def test_merge_temporary_result_keeps_modification_count
+    result = @comments.select("content:@Hello")
+    count = context.database.modification_count
+    result.merge!(@comments.select("content:@World"))
+    assert_equal(count, context.database.modification_count)
+  end
+
+  def test_query_by_expression_keeps_modification_count
+    count = context.database.modification_count
+    @comments.select do |record|
+      record.content =~ "Hello"
+    end
+    expression = Groonga::Expression.new
+    expression.define_variable(:domain => @comments)
+    expression.parse("content:@Hello")
+    @comments.select(expression)
+    assert_equal(count, context.database.modification_count)
+  end
+
+  def test_select_command_keeps_modification_count
+    count = context.database.modification_count
+    context.select(@comments, :query => "content:@Hello")
+    assert_equal(count, context.database.modification_count)
+  end
+
+  def test_query_with_cache_and_update
+    assert_equal_select_result([@comment3],
+                               @comments.select("content:@test",
+                                                :cache => true))
+    @comments.select("content = \"updated test\"", :syntax => :script)
+    assert_equal_select_result([@comment1, @comment2, @comment3,
+                                @japanese_comment],
+                               @comments.select("content:@test",
+                                                :cache => true))
+  end
+
+  def test_query_without_update_keeps_modification_count
+    count = context.database.modification_count
+    @comments.select("content:@Hello")
+    @comments.select("content @ \"Hello\"", :syntax => :script,
+                     :allow_update => false)
+    assert_equal(count, context.database.modification_count)
+  end
+
+  def test_query_with_cache_and_touch
+    result = @comments.select("content:@Hello", :cache => true)
+    context.database.touch
+    assert_not_same(result, @comments.select("content:@Hello", :cache => true))
+  end
+
+  def test_query_parallel
+    result = @comments.select("content:@Hello", :parallel => 2)
+    assert_equal_select_result([@comment1, @comment2], result)
+    assert_equal(select_scores(@comments.select("content:@Hello")),
+                 select_scores(result))
+  end
+
+  def test_query_parallel_without_index
+    memos = Groonga::Array.create(:name => "Memos")
+    memos.define_column("title", "ShortText")
+    memos.define_column("priority", "Int32")
+    10.times do |i|
+      memos.add(:title => "memo #{i}", :priority => i % 3)
+    end
+
+    ["title:@memo", "priority:1", "priority:>0 OR title:@9"].each do |query|
+      serial = memos.select(query)
+      parallel = memos.select(query, :parallel => 3)
+      assert_equal(select_scores(serial), select_scores(parallel), query)
+    end
+  end
+
+  def test_query_parallel_with_update
+    memos = Groonga::Array.create(:name => "Memos")
+    memos.define_column("title", "ShortText")
+    memo = memos.add(:title => "memo")
+    memos.select("title = \"updated\"",
+                 :syntax => :script, :parallel => 2)
+    assert_equal("updated", memo["title"])
+  end
+
+  def test_query_id_bitmap
+    bitmap = @comments.select("content:@Hello", :id_bitmap => true)
+    assert_equal([@comment1.id, @comment2.id], bitmap.to_a)
+    assert_equal([@comment2.id],
+                 (bitmap & @comments.select("content:@World",
+                                            :id_bitmap => true)).to_a)
+  end
+
+  def test_select_each
+    ids = []
+    @comments.select_each("content:@Hello") do |id, score|
+      ids << [id, score]
+    end
+    assert_equal(select_scores(@comments.select("content:@Hello")),
+                 ids.sort)
+  end
+
+  def test_select_each_without_index
+    memos = Groonga::Array.create(:name => "Memos")
+    memos.define_column("title", "ShortText")
+    memo1 = memos.add(:title => "memo 1")
+    memos.add(:title => "note 2")
+    memo3 = memos.add(:title => "memo 3")
+    assert_equal([[memo1.id, 1], [memo3.id, 1]],
+                 memos.select_each("title:@memo").to_a)
+    assert_equal([[memo1.id, 1]],
+                 memos.select_each("title:@memo", :limit => 1).to_a)
+  end
+
+  def test_select_each_with_limit
+    assert_equal(1,
+                 @comments.select_each("content:@Hello", :limit => 1).to_a.size)
+  end
+
+  def test_select_each_with_exception
+    assert_raise(RuntimeError) do
+      @comments.select_each("content:@Hello") do |id, score|
+        raise "stop"
+      end
+    end
+    ids = @comments.select_each("content:@Hello").collect {|id,| id}
+    assert_equal([@comment1.id, @comment2.id], ids.sort)
+  end
+
   def test_query_with_parser
     result = @comments.select("content @ \"Hello\"", :syntax => :script)
     assert_equal_select_result([@comment1, @comment2], result)
@@ -182,4 +420,11 @@ class TableSelectTest < Test::Unit::TestCase
     end
     assert_equal_select_result([], result)
   end
+
+  private
+  def select_scores(result)
+    result.collect do |record|
+      [record.key.id, record.score]
+    end.sort
+  end
 end
@@ -400,6 +400,64 @@ class TableTest < Test::Unit::TestCase
                  bookmarks.sort([{:key => "uri", :order => :descending}]))
   end
 
+  def test_sort_parallel
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("price", "Int32")
+    prices = [5, 3, 8, 1, 9, 3, 7, 2, 6, 4]
+    prices.each do |price|
+      items.add(:price => price)
+    end
+
+    expected = items.sort([["price", :desc], ["_id", :asc]])
+    assert_equal(expected.collect {|item| item.id},
+                 items.sort([["price", :desc]],
+                            :parallel => 3).collect {|item| item.id})
+    assert_equal(expected[2, 4].collect {|item| item.id},
+                 items.sort([["price", :desc]],
+                            :parallel => 3,
+                            :offset => 2,
+                            :limit => 4).collect {|item| item.id})
+  end
+
+  def test_top_k
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("price", "Int32")
+    items.define_column("name", "ShortText")
+    apple = items.add(:price => 100, :name => "apple")
+    orange = items.add(:price => 300, :name => "orange")
+    banana = items.add(:price => 200, :name => "banana")
+    grape = items.add(:price => 300, :name => "grape")
+
+    assert_equal([[orange.id, 300], [grape.id, 300], [banana.id, 200]],
+                 items.top_k([["price", :desc]], 3))
+    assert_equal([[apple.id, "apple"], [banana.id, "banana"]],
+                 items.top_k(["name"], 2))
+  end
+
+  def test_top_k_same_values
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("price", "Int32")
+    items.define_column("name", "ShortText")
+    first = items.add(:price => 300, :name => "apple")
+    second = items.add(:price => 300, :name => "apple")
+    third = items.add(:price => 300, :name => "apple")
+
+    assert_equal([first.id, second.id, third.id],
+                 items.top_k([["price", :desc]], 3).collect {|id,| id})
+    assert_equal([first.id, second.id, third.id],
+                 items.top_k([["price", :desc], "name"], 3).collect {|id,| id})
+  end
+
+  def test_top_k_larger_than_size
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("price", "Int32")
+    apple = items.add(:price => 100)
+    orange = items.add(:price => 300)
+
+    assert_equal([[orange.id, 300], [apple.id, 100]],
+                 items.top_k([["price", :desc]], 2 ** 31 - 1))
+  end
+
   def test_group
     bookmarks = Groonga::Hash.create(:name => "Bookmarks")
     bookmarks.define_column("title", "Text")
@@ -443,6 +501,91 @@ class TableTest < Test::Unit::TestCase
                  end)
   end
 
+  def test_group_with_limit_and_aggregate
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("category", "ShortText")
+    items.define_column("price", "Int32")
+
+    items.add(:category => "book", :price => 1000)
+    items.add(:category => "book", :price => 1500)
+    items.add(:category => "book", :price => 500)
+    items.add(:category => "food", :price => 300)
+    items.add(:category => "food", :price => 200)
+    items.add(:category => "toy", :price => 800)
+
+    categories = items.group("category",
+                             :limit => 2,
+                             :aggregate => {"price" => [:sum, :max]})
+    assert_equal([["book", 3, {:sum => 3000, :max => 1500}],
+                  ["food", 2, {:sum => 500, :max => 300}]],
+                 categories.sort([["_nsubrecs", :desc]]).collect do |record|
+                   [record.key,
+                    record.n_sub_records,
+                    categories.aggregates[record.id]["price"]]
+                 end)
+  end
+
+  def test_group_with_aggregate_integer_sum
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("category", "ShortText")
+    items.define_column("price", "Int64")
+    items.add(:category => "book", :price => 2 ** 53)
+    items.add(:category => "book", :price => 1)
+
+    categories = items.group("category",
+                             :aggregate => {"price" => [:sum, :average]})
+    price = categories.aggregates[categories["book"].id]["price"]
+    assert_equal({:sum => 2 ** 53 + 1, :average => (2 ** 53 + 1) / 2.0},
+                 price)
+    assert_kind_of(Integer, price[:sum])
+  end
+
+  def test_group_with_negative_limit
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("category", "ShortText")
+    assert_raise(ArgumentError) do
+      items.group("category", :limit => -1)
+    end
+  end
+
+  def test_group_with_aggregate_by_vector_key
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("tags", "ShortText", :type => :vector)
+    items.define_column("price", "Int32")
+    items.add(:tags => ["book", "new"], :price => 1000)
+
+    assert_raise(ArgumentError) do
+      items.group("tags", :aggregate => {"price" => [:sum]})
+    end
+  end
+
+  def test_drilldown
+    items = Groonga::Array.create(:name => "Items")
+    items.define_column("category", "ShortText")
+    items.define_column("maker", "ShortText")
+
+    items.add(:category => "book", :maker => "A")
+    items.add(:category => "book", :maker => "B")
+    items.add(:category => "book", :maker => "B")
+    items.add(:category => "food", :maker => "B")
+    items.add(:category => "food", :maker => "A")
+    items.add(:category => "toy", :maker => "C")
+
+    drilldowns = items.drilldown(["category", "maker"], :limit => 2)
+    assert_equal({
+                   "category" => [["book", 3], ["food", 2]],
+                   "maker" => [["B", 3], ["A", 2]],
+                 },
+                 {
+                   "category" => drilldowns["category"].collect do |record|
+                     [record.key, record.n_sub_records]
+                   end,
+                   "maker" => drilldowns["maker"].collect do |record|
+                     [record.key, record.n_sub_records]
+                   end,
+                 })
+  end
+
   def test_group_with_unknown_key
     bookmarks = Groonga::Hash.create(:name => "Bookmarks")
     message = "unknown group key: <\"nonexistent\">: <#{bookmarks.inspect}>"
@@ -481,6 +624,84 @@ class TableTest < Test::Unit::TestCase
                  end)
   end
 
+  def test_intersection_with_smaller_table!
+    bookmarks = Groonga::Hash.create(:name => "bookmarks")
+    bookmarks.define_column("title", "ShortText")
+
+    bookmarks.add("http://groonga.org/", :title => "groonga")
+    bookmarks.add("http://ruby-lang.org/", :title => "Ruby")
+    bookmarks.add("http://rroonga.rubyforge.org/", :title => "rroonga")
+
+    ruby_bookmarks = bookmarks.select {|record| record["title"] == "Ruby"}
+    all_bookmarks = bookmarks.select
+    assert_equal(["Ruby"],
+                 all_bookmarks.intersection!(ruby_bookmarks).collect do |record|
+                   record[".title"]
+                 end)
+  end
+
+  def test_intersection_score
+    bookmarks = Groonga::Hash.create(:name => "bookmarks")
+    bookmarks.define_column("title", "ShortText")
+
+    bookmarks.add("http://groonga.org/", :title => "groonga")
+    bookmarks.add("http://ruby-lang.org/", :title => "Ruby")
+    bookmarks.add("http://rroonga.rubyforge.org/", :title => "rroonga")
+
+    ruby_bookmarks = bookmarks.select {|record| record["title"] == "Ruby"}
+    all_bookmarks = bookmarks.select
+    assert_equal([["Ruby", 2]],
+                 all_bookmarks.intersection!(ruby_bookmarks).collect do |record|
+                   [record[".title"], record.score]
+                 end)
+
+    ruby_bookmarks = bookmarks.select {|record| record["title"] == "Ruby"}
+    all_bookmarks = bookmarks.select
+    assert_equal([["Ruby", 2]],
+                 ruby_bookmarks.intersection!(all_bookmarks).collect do |record|
+                   [record[".title"], record.score]
+                 end)
+  end
+
+  def test_intersect_all_with_result
+    bookmarks = Groonga::Hash.create(:name => "bookmarks")
+    bookmarks.define_column("title", "ShortText")
+
+    bookmarks.add("http://groonga.org/", :title => "groonga")
+    bookmarks.add("http://ruby-lang.org/", :title => "Ruby")
+
+    groonga_bookmarks = bookmarks.select do |record|
+      record["title"] == "groonga"
+    end
+    ruby_bookmarks = bookmarks.select {|record| record["title"] == "Ruby"}
+    all_bookmarks = bookmarks.select
+    result = Groonga::Table.intersect_all([all_bookmarks, groonga_bookmarks])
+    Groonga::Table.intersect_all([all_bookmarks, ruby_bookmarks],
+                                 :result => result)
+    assert_equal([["Ruby", 2]],
+                 result.collect {|record| [record[".title"], record.score]})
+  end
+
+  def test_intersect_all
+    bookmarks = Groonga::Hash.create(:name => "bookmarks")
+    bookmarks.define_column("title", "ShortText")
+
+    bookmarks.add("http://groonga.org/", :title => "groonga")
+    bookmarks.add("http://ruby-lang.org/", :title => "Ruby")
+    bookmarks.add("http://rroonga.rubyforge.org/", :title => "rroonga")
+
+    all_bookmarks = bookmarks.select
+    not_groonga_bookmarks = bookmarks.select do |record|
+      record["title"] != "groonga"
+    end
+    ruby_bookmarks = bookmarks.select {|record| record["title"] == "Ruby"}
+    tables = [all_bookmarks, not_groonga_bookmarks, ruby_bookmarks]
+    result = Groonga::Table.intersect_all(tables)
+    assert_equal([["Ruby", 3]],
+                 result.collect {|record| [record[".title"], record.score]})
+    assert_equal([3, 2, 1], tables.collect {|table| table.size})
+  end
+
   def test_difference!
     bookmarks = Groonga::Hash.create(:name => "Bookmarks")
     bookmarks.define_column("title", "ShortText")
@@ -579,6 +800,20 @@ class TableTest < Test::Unit::TestCase
                  users["morita"].attributes)
   end
 
+  def test_reference_column_value_ids
+    users = Groonga::Hash.create(:name => "Users",
+                                 :key_type => "ShortText")
+    books = Groonga::Hash.create(:name => "Books",
+                                 :key_type => "ShortText")
+    users.define_column("book", books)
+    groonga = books.add("groonga")
+    users.add("morita", :book => groonga)
+    users.add("yu")
+    assert_equal([groonga.id, nil],
+                 [users.column_value("morita", "book", :ids => true),
+                  users.column_value("yu", "book", :ids => true)])
+  end
+
   def test_have_column
     users = Groonga::Hash.create(:name => "Users",
                                  :key_type => "ShortText")
@@ -65,6 +65,65 @@ class VectorColumnTest < Test::Unit::TestCase
                  shinjuku["communities"].collect {|record| record.key})
   end
 
+  def test_column_value_ids
+    groonga = @communities.add("groonga")
+    morita = @users.add(29)
+    yu = @users.add(30)
+    groonga["users"] = [morita, yu]
+
+    assert_equal([[morita.id, yu.id], []],
+                 [@communities.column_value("groonga", "users", :ids => true),
+                  @communities.column_value(@communities.add("senna").id,
+                                            "users",
+                                            :id => true, :ids => true)])
+  end
+
+  def test_column_value_packed
+    groonga = @communities.add("groonga")
+    morita = @users.add(29)
+    yu = @users.add(30)
+    groonga["users"] = [morita, yu]
+
+    packed = @communities.column_value("groonga", "users", :packed => true)
+    assert_equal([morita.id, yu.id], packed.unpack("I*"))
+  end
+
+  def test_column_value_weight_of_stored_value
+    @communities.define_column("tags", "ShortText", :type => :vector)
+    @communities.add("groonga", :tags => ["search", "engine"])
+
+    # rroonga stores vector elements with weight 0.
+    assert_equal([["search", 0], ["engine", 0]],
+                 @communities.column_value("groonga", "tags", :weight => true))
+    assert_equal(["search", "engine"], @communities["groonga"]["tags"])
+  end
+
+  def test_time_vector_time_format
+    issued_column = @communities.define_column("issued", "Time",
+                                               :type => :vector)
+    issued = [Time.at(1187430026, 123456), Time.at(1187430027)]
+    groonga = @communities.add("groonga", :issued => issued)
+
+    issued_column.time_format = :usec
+    usec = groonga["issued"]
+    weighted_usec = @communities.column_value("groonga", "issued",
+                                              :weight => true)
+    issued_column.time_format = :time
+    assert_equal([[1187430026123456, 1187430027000000],
+                  [[1187430026123456, 0], [1187430027000000, 0]],
+                  issued],
+                 [usec, weighted_usec, groonga["issued"]])
+  end
+
+  def test_set_packed_ids
+    groonga = @communities.add("groonga")
+    morita = @users.add(29)
+    yu = @users.add(30)
+    groonga["users"] = [yu.id, morita.id].pack("I*")
+
+    assert_equal([30, 29], groonga["users"].collect {|record| record.key})
+  end
+
   def test_set_nil
     groonga = @communities.add("groonga")
     assert_equal([], groonga["users"])